@@ -0,0 +1,248 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// access_trace.cpp
+//
+// Identification: src/buffer/access_trace.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/access_trace.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace bustub {
+
+static constexpr char ACCESS_TRACE_MAGIC[8] = {'B', 'P', 'T', 'R', 'A', 'C', 'E', '1'};
+static constexpr uint32_t ACCESS_TRACE_VERSION = 1;
+
+std::atomic<bool> AccessTracer::enabled_{false};
+
+/** 一个线程的单生产者单消费者环形缓冲区：本线程写 tail_，刷写线程写 head_ */
+struct AccessTracer::Ring {
+  explicit Ring(uint16_t thread) : thread_(thread) {}
+
+  uint16_t thread_;
+  /** 下一条待刷写的记录，只由刷写线程写 */
+  alignas(64) std::atomic<uint64_t> head_{0};
+  /** 下一条要写入的位置，只由所属线程写；与 head_ 分在不同缓存行，免得两边互相抖动 */
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+  /** 所属线程已退出，刷写线程取完剩余记录后释放本环 */
+  std::atomic<bool> finished_{false};
+  std::array<AccessTraceRecord, ACCESS_TRACE_RING_SIZE> records_;
+};
+
+auto AccessTracer::Instance() -> AccessTracer & {
+  // 与 MetricsRegistry 相同，故意不析构
+  static auto *tracer = new AccessTracer();
+  return *tracer;
+}
+
+auto AccessTracer::LocalRing() -> Ring * {
+  thread_local Ring *ring = nullptr;
+  thread_local bool exiting = false;
+  // 线程退出时只做标记，由刷写线程取完剩余记录后释放；之后再有记录直接丢弃
+  struct Finisher {
+    ~Finisher() {
+      if (ring != nullptr) {
+        ring->finished_.store(true, std::memory_order_release);
+      }
+      ring = nullptr;
+      exiting = true;
+    }
+  };
+  if (ring == nullptr && !exiting) {
+    thread_local Finisher finisher;
+    std::scoped_lock<std::mutex> lock(rings_latch_);
+    uint16_t thread = static_cast<uint16_t>(rings_.size());
+    if (!free_threads_.empty()) {
+      thread = free_threads_.back();
+      free_threads_.pop_back();
+    }
+    rings_.push_back(std::make_unique<Ring>(thread));
+    ring = rings_.back().get();
+  }
+  return ring;
+}
+
+void AccessTracer::Record(AccessTraceOp op, page_id_t page_id, uint8_t flags, page_id_t victim_page_id,
+                          uint32_t pin_count) {
+  Ring *ring = LocalRing();
+  if (ring == nullptr) {
+    return;
+  }
+  uint64_t tail = ring->tail_.load(std::memory_order_relaxed);
+  if (tail - ring->head_.load(std::memory_order_acquire) >= ACCESS_TRACE_RING_SIZE) {
+    // 刷写线程跟不上时丢弃，不让缓冲池等待；只有本线程写 dropped_，不需要原子加
+    ring->dropped_.store(ring->dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return;
+  }
+  AccessTraceRecord &record = ring->records_[tail & (ACCESS_TRACE_RING_SIZE - 1)];
+  auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+                 .count();
+  record.timestamp_ns_ = static_cast<uint64_t>(now - start_ns_);
+  record.page_id_ = page_id;
+  record.victim_page_id_ = victim_page_id;
+  record.pin_count_ = pin_count;
+  record.thread_ = ring->thread_;
+  record.op_ = op;
+  record.flags_ = flags;
+  // release：刷写线程看到新的 tail_ 时，记录内容已经写完
+  ring->tail_.store(tail + 1, std::memory_order_release);
+}
+
+void AccessTracer::Drain() {
+  // 只在取环列表时持有 rings_latch_；环只由刷写线程释放，所以之后不加锁读取也安全
+  {
+    std::scoped_lock<std::mutex> lock(rings_latch_);
+    for (auto &ring : rings_) {
+      drain_rings_.push_back(ring.get());
+    }
+  }
+  bool any_finished = false;
+  for (Ring *ring : drain_rings_) {
+    // 先读 finished_ 再读 tail_：看到退出标记时，该线程的全部记录都可见
+    bool finished = ring->finished_.load(std::memory_order_acquire);
+    uint64_t head = ring->head_.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail_.load(std::memory_order_acquire);
+    for (uint64_t i = head; i < tail; i++) {
+      batch_.push_back(ring->records_[i & (ACCESS_TRACE_RING_SIZE - 1)]);
+    }
+    // 先复制出来再前移 head_，之后这些槽位才可能被覆盖
+    ring->head_.store(tail, std::memory_order_release);
+    any_finished = any_finished || finished;
+  }
+  drain_rings_.clear();
+  if (!batch_.empty()) {
+    if (file_ != nullptr) {
+      records_ += fwrite(batch_.data(), sizeof(AccessTraceRecord), batch_.size(), file_);
+    }
+    batch_.clear();
+  }
+
+  if (any_finished) {
+    std::scoped_lock<std::mutex> lock(rings_latch_);
+    auto live = std::partition(rings_.begin(), rings_.end(), [](const std::unique_ptr<Ring> &ring) {
+      return !ring->finished_.load(std::memory_order_acquire);
+    });
+    // 在上面取完之后才退出的线程，其环可能还有记录，留到下一轮
+    for (auto it = live; it != rings_.end(); ++it) {
+      if ((*it)->head_.load(std::memory_order_relaxed) != (*it)->tail_.load(std::memory_order_acquire)) {
+        std::iter_swap(live++, it);
+      }
+    }
+    for (auto it = live; it != rings_.end(); ++it) {
+      retired_dropped_ += (*it)->dropped_.load(std::memory_order_relaxed);
+      free_threads_.push_back((*it)->thread_);
+    }
+    rings_.erase(live, rings_.end());
+  }
+}
+
+void AccessTracer::FlushLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (!stopping_) {
+    stop_cv_.wait_for(lock, ACCESS_TRACE_FLUSH_INTERVAL, [this] { return stopping_; });
+    // 写文件时不持有 latch_；Drain() 只由本线程调用，Stop() 等本线程结束后才关闭文件
+    lock.unlock();
+    Drain();
+    lock.lock();
+  }
+}
+
+auto AccessTracer::Start(const std::string &file_name) -> bool {
+  std::scoped_lock<std::mutex> lock(latch_);
+  if (file_ != nullptr) {
+    return false;
+  }
+  // 没有文件时 Drain() 丢掉上一次跟踪停止时还在途中的记录，并释放其间退出的线程的环
+  Drain();
+  file_ = fopen(file_name.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+
+  AccessTraceHeader header{};
+  memcpy(header.magic_, ACCESS_TRACE_MAGIC, sizeof(header.magic_));
+  header.version_ = ACCESS_TRACE_VERSION;
+  header.record_size_ = sizeof(AccessTraceRecord);
+  header.start_unix_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::system_clock::now().time_since_epoch())
+                              .count();
+  fwrite(&header, sizeof(header), 1, file_);
+
+  {
+    std::scoped_lock<std::mutex> rings_lock(rings_latch_);
+    for (auto &ring : rings_) {
+      ring->dropped_.store(0, std::memory_order_relaxed);
+    }
+    retired_dropped_ = 0;
+  }
+  records_ = 0;
+  stopping_ = false;
+  start_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                  .count();
+  flusher_ = std::thread(&AccessTracer::FlushLoop, this);
+  enabled_.store(true, std::memory_order_release);
+  return true;
+}
+
+auto AccessTracer::Stop() -> Stats {
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    if (file_ == nullptr || stopping_) {
+      return {0, 0};
+    }
+    enabled_.store(false, std::memory_order_relaxed);
+    stopping_ = true;
+  }
+  stop_cv_.notify_all();
+  flusher_.join();
+
+  std::scoped_lock<std::mutex> lock(latch_);
+  Drain();
+  Stats stats{records_, 0};
+  {
+    std::scoped_lock<std::mutex> rings_lock(rings_latch_);
+    stats.dropped_ = retired_dropped_;
+    for (auto &ring : rings_) {
+      stats.dropped_ += ring->dropped_.load(std::memory_order_relaxed);
+    }
+  }
+  fclose(file_);
+  file_ = nullptr;
+  return stats;
+}
+
+auto AccessTracer::Load(const std::string &file_name, std::vector<AccessTraceRecord> *records) -> bool {
+  std::FILE *file = fopen(file_name.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  AccessTraceHeader header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+            memcmp(header.magic_, ACCESS_TRACE_MAGIC, sizeof(header.magic_)) == 0 &&
+            header.version_ == ACCESS_TRACE_VERSION && header.record_size_ == sizeof(AccessTraceRecord);
+  if (ok) {
+    records->clear();
+    AccessTraceRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+      records->push_back(record);
+    }
+    // 各线程的记录按刷写批次交错存放，按时间戳合并；同一时间戳保持文件中的顺序
+    std::stable_sort(records->begin(), records->end(), [](const AccessTraceRecord &a, const AccessTraceRecord &b) {
+      return a.timestamp_ns_ < b.timestamp_ns_;
+    });
+  }
+  fclose(file);
+  return ok;
+}
+
+}  // namespace bustub
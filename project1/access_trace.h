@@ -0,0 +1,185 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// access_trace.h
+//
+// Identification: src/include/buffer/access_trace.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * Build with -DBUSTUB_ACCESS_TRACE=0 to compile the trace points of the buffer
+ * pool out. Compiled in, a trace point costs one load of a flag while no trace
+ * is being written.
+ */
+#ifndef BUSTUB_ACCESS_TRACE
+#define BUSTUB_ACCESS_TRACE 1
+#endif
+
+namespace bustub {
+
+/** Records per thread that may wait for the flusher; more are dropped. Must be a power of two. */
+static constexpr size_t ACCESS_TRACE_RING_SIZE = 1 << 14;
+/** How often the flusher writes out the records of all threads. */
+static constexpr std::chrono::milliseconds ACCESS_TRACE_FLUSH_INTERVAL{10};
+
+enum class AccessTraceOp : uint8_t {
+  FETCH,
+  NEW,
+  UNPIN,
+  DELETE,
+  /** A clean page evicted ahead of time to refill the free list; page_id_ is the evicted page. */
+  EVICT,
+};
+
+/** FETCH found the page in the pool; DELETE removed it from the pool. */
+static constexpr uint8_t ACCESS_TRACE_HIT = 1;
+/** The victim was dirty and written back. */
+static constexpr uint8_t ACCESS_TRACE_VICTIM_DIRTY = 2;
+/** UNPIN marked the page dirty. */
+static constexpr uint8_t ACCESS_TRACE_DIRTY = 4;
+/** The call failed: no frame was free, the page was not pinned, or was pinned when deleted. */
+static constexpr uint8_t ACCESS_TRACE_FAILED = 8;
+
+/** One buffer pool call, as stored in a trace file. */
+struct AccessTraceRecord {
+  /** Nanoseconds since the trace was started. */
+  uint64_t timestamp_ns_;
+  page_id_t page_id_;
+  /** The page evicted to make room, INVALID_PAGE_ID if none. */
+  page_id_t victim_page_id_;
+  /** Pin count of the page after the call. */
+  uint32_t pin_count_;
+  /** Index of the calling thread within the trace; the indices of exited threads are reused. */
+  uint16_t thread_;
+  AccessTraceOp op_;
+  uint8_t flags_;
+};
+static_assert(sizeof(AccessTraceRecord) == 24, "trace records are written as they are in memory");
+
+/** Start of a trace file; the records follow, each thread's in order, threads interleaved in flush batches. */
+struct AccessTraceHeader {
+  char magic_[8];
+  uint32_t version_;
+  uint32_t record_size_;
+  /** Wall clock time the trace was started, in nanoseconds since the epoch. */
+  uint64_t start_unix_ns_;
+};
+
+/**
+ * Writes a binary trace of the calls to BufferPoolManagerInstance, for replacer
+ * simulations and for explaining changes of the hit rate.
+ *
+ * Each thread appends its records to its own ring buffer without locks or
+ * atomic read-modify-writes; a flusher thread started by Start() drains the
+ * rings to the file every ACCESS_TRACE_FLUSH_INTERVAL. If a ring is full, the
+ * record is dropped and counted rather than making the buffer pool wait. A
+ * thread takes a short lock once, to register its ring on its first record;
+ * the flusher holds that lock only to list the rings, never across a write.
+ * The ring of an exited thread is freed once the flusher has drained it.
+ *
+ * Tracing covers all buffer pool instances of the process.
+ */
+class AccessTracer {
+ public:
+  struct Stats {
+    uint64_t records_;
+    uint64_t dropped_;
+  };
+
+  static auto Instance() -> AccessTracer &;
+
+  /** @return whether a trace is being written */
+  static auto Enabled() -> bool {
+#if BUSTUB_ACCESS_TRACE
+    // Acquire, so that a thread seeing the flag also sees the start time
+    return enabled_.load(std::memory_order_acquire);
+#else
+    return false;
+#endif
+  }
+
+  /** Append a record for the calling thread, if tracing. */
+  static void Trace(AccessTraceOp op, page_id_t page_id, uint8_t flags, page_id_t victim_page_id,
+                    uint32_t pin_count) {
+    if (Enabled()) {
+      Instance().Record(op, page_id, flags, victim_page_id, pin_count);
+    }
+  }
+
+  /** Start writing a trace to file_name; @return false if one is being written or the file can't be created */
+  auto Start(const std::string &file_name) -> bool;
+
+  /**
+   * Stop tracing and write out the remaining records. Records of calls that
+   * race with Stop() may be lost.
+   * @return the records written and dropped
+   */
+  auto Stop() -> Stats;
+
+  /**
+   * Read a trace file, with the records of all threads in timestamp order.
+   * @return false if the file can't be read or is not a trace
+   */
+  static auto Load(const std::string &file_name, std::vector<AccessTraceRecord> *records) -> bool;
+
+ private:
+  struct Ring;
+
+  AccessTracer() = default;
+
+  void Record(AccessTraceOp op, page_id_t page_id, uint8_t flags, page_id_t victim_page_id, uint32_t pin_count);
+  /** @return the calling thread's ring, nullptr once the thread has begun to exit */
+  auto LocalRing() -> Ring *;
+  /**
+   * Write the records of all rings to the file and free the rings of exited
+   * threads. Called only by the flusher, and by Start() and Stop() while no
+   * flusher runs.
+   */
+  void Drain();
+  void FlushLoop();
+
+  static std::atomic<bool> enabled_;
+
+  /** Protects the rings and the thread indices. */
+  std::mutex rings_latch_;
+  /** Rings of the threads that traced, until drained after the thread exits. */
+  std::vector<std::unique_ptr<Ring>> rings_;
+  /** Thread indices of freed rings, for reuse. */
+  std::vector<uint16_t> free_threads_;
+  /** Records the freed rings dropped. */
+  uint64_t retired_dropped_{0};
+
+  /** Protects the members below. */
+  std::mutex latch_;
+  std::condition_variable stop_cv_;
+  bool stopping_{false};
+  std::FILE *file_{nullptr};
+  std::thread flusher_;
+  /** steady_clock time the trace was started, in nanoseconds. */
+  int64_t start_ns_{0};
+  uint64_t records_{0};
+  /** Buffers Drain() gathers the rings and their records in. */
+  std::vector<Ring *> drain_rings_;
+  std::vector<AccessTraceRecord> batch_;
+};
+
+}  // namespace bustub
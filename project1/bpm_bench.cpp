@@ -0,0 +1,146 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bpm_bench.cpp
+//
+// Identification: tools/bpm_bench/bpm_bench.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/rwlatch.h"
+#include "storage/disk/disk_manager.h"
+
+/**
+ * Measures pin/latch/unpin throughput when every thread works on its own frame, once with the frames of the threads
+ * adjacent and once with them SPREAD_STRIDE frames apart. When frame descriptors share cache lines, the adjacent
+ * run is slower, although the threads never touch the same frame.
+ *
+ * Both runs are done for the cache-line aligned Page objects of the buffer pool and for PackedDescriptor, a packed
+ * copy of the fields the loop touches laid out like an unaligned descriptor array, so the two layouts can be
+ * compared side by side.
+ *
+ * Usage: bpm_bench [threads] [duration_ms]
+ */
+
+namespace {
+
+constexpr size_t SPREAD_STRIDE = 16;
+
+/**
+ * The pin count, dirty flag and latch of a frame without cache-line alignment: packed to 4 bytes, so an array of
+ * them puts the fields of neighbouring frames on shared cache lines. Pin()/Unpin() mirror the fast path of Page.
+ */
+#pragma pack(push, 4)
+struct PackedDescriptor {
+  void Pin() { pin_count_.fetch_add(1); }
+
+  void Unpin(bool is_dirty) {
+    if (is_dirty) {
+      is_dirty_ = true;
+    }
+    int pin_count = pin_count_;
+    while (pin_count > 1 && !pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+    }
+  }
+
+  void RLatch() { latch_.RLock(); }
+  void RUnlatch() { latch_.RUnlock(); }
+
+  bustub::page_id_t page_id_{bustub::INVALID_PAGE_ID};
+  std::atomic<int> pin_count_{1};
+  std::atomic<bool> is_dirty_{false};
+  bustub::ReaderWriterLatch latch_{"page"};
+};
+#pragma pack(pop)
+
+template <typename Frame>
+auto RunBench(const std::vector<Frame *> &pages, size_t threads, size_t stride, size_t duration_ms) -> double {
+  std::atomic<bool> stop{false};
+  std::vector<uint64_t> ops(threads);
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      // 每个线程只碰自己的帧：Page::Pin()/Unpin() 走快速路径，不经过缓冲池的 latch_
+      Frame *page = pages[t * stride];
+      uint64_t count = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        page->Pin();
+        page->RLatch();
+        page->RUnlatch();
+        page->Unpin(false);
+        count++;
+      }
+      ops[t] = count;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+  stop = true;
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  uint64_t total = 0;
+  for (uint64_t count : ops) {
+    total += count;
+  }
+  return static_cast<double>(total) / static_cast<double>(duration_ms) / 1000.0;
+}
+
+}  // namespace
+
+auto main(int argc, char **argv) -> int {
+  size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+  size_t duration_ms = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+  if (threads == 0 || duration_ms == 0) {
+    fprintf(stderr, "usage: %s [threads] [duration_ms]\n", argv[0]);
+    return 1;
+  }
+
+  const std::string db_file = "bpm_bench.db";
+  auto *disk_manager = new bustub::DiskManager(db_file);
+  size_t pool_size = threads * SPREAD_STRIDE;
+  auto *bpm = new bustub::BufferPoolManagerInstance(pool_size, disk_manager);
+
+  // 新建的页一直保持 pin 住，压测线程在这个 pin 之上做 Pin()/Unpin()
+  std::vector<bustub::Page *> pages;
+  for (size_t i = 0; i < pool_size; ++i) {
+    bustub::page_id_t page_id;
+    pages.push_back(bpm->NewPage(&page_id));
+  }
+
+  // 对照组：同样多的描述符紧挨着排列，相邻帧的字段落在同一缓存行上
+  std::unique_ptr<PackedDescriptor[]> packed(new PackedDescriptor[pool_size]);
+  std::vector<PackedDescriptor *> descriptors;
+  for (size_t i = 0; i < pool_size; ++i) {
+    descriptors.push_back(&packed[i]);
+  }
+
+  printf("%-18s %6s %6s %17s %15s\n", "layout", "size", "align", "adjacent Mops/s", "spread Mops/s");
+  printf("%-18s %6zu %6zu %17.2f %15.2f\n", "Page (aligned)", sizeof(bustub::Page), alignof(bustub::Page),
+         RunBench(pages, threads, 1, duration_ms), RunBench(pages, threads, SPREAD_STRIDE, duration_ms));
+  printf("%-18s %6zu %6zu %17.2f %15.2f\n", "packed descriptor", sizeof(PackedDescriptor), alignof(PackedDescriptor),
+         RunBench(descriptors, threads, 1, duration_ms), RunBench(descriptors, threads, SPREAD_STRIDE, duration_ms));
+
+  for (auto *page : pages) {
+    bpm->UnpinPage(page->GetPageId(), false);
+  }
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  std::remove(db_file.c_str());
+  std::remove("bpm_bench.log");
+  return 0;
+}
@@ -0,0 +1,223 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager.h
+//
+// Identification: src/include/buffer/buffer_pool_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+
+#include "buffer/lru_k_replacer.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/** Identifies a partition of a buffer pool, see BufferPoolManager::CreatePartition(). */
+using partition_id_t = int32_t;
+/** No partition requested: a page keeps the partition it is in, or goes to the default one. */
+static constexpr partition_id_t INVALID_PARTITION_ID = -1;
+/** The partition every page belongs to unless it is created or fetched for another one. */
+static constexpr partition_id_t DEFAULT_PARTITION_ID = 0;
+
+/**
+ * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ */
+class BufferPoolManager {
+ public:
+  BufferPoolManager() = default;
+  virtual ~BufferPoolManager() = default;
+
+  /** @brief Create a new page in the buffer pool. */
+  auto NewPage(page_id_t *page_id) -> Page * { return NewPgImp(page_id); }
+
+  /**
+   * @brief Create a new page in the buffer pool, preferring a page id physically close to hint
+   * (e.g. the parent or sibling of the new page), and charge its frame to the given partition.
+   */
+  auto NewPage(page_id_t *page_id, page_id_t hint, partition_id_t partition = INVALID_PARTITION_ID) -> Page * {
+    return NewPgNearImp(page_id, hint, partition);
+  }
+
+  /**
+   * @brief Create n new pages at once, e.g. for a bulk load, with contiguous page ids if the implementation
+   * supports it. Either all n pages are created, pinned, or none. BPlusTree::ImportSnapshot() creates the nodes
+   * of each level this way; since all n pages stay pinned until the caller unpins them, keep n well below the
+   * pool size.
+   * @param n number of pages to create
+   * @param[out] page_ids ids of the created pages
+   * @param[out] pages the created pages
+   * @param partition partition to charge the frames to
+   * @return false if n pages could not be created
+   */
+  auto NewPages(size_t n, page_id_t *page_ids, Page **pages, partition_id_t partition = INVALID_PARTITION_ID)
+      -> bool {
+    return NewPgsImp(n, page_ids, pages, partition);
+  }
+
+  /** @brief Fetch the requested page from the buffer pool. */
+  auto FetchPage(page_id_t page_id) -> Page * { return FetchPgImp(page_id); }
+
+  /** @brief Fetch the requested page from the buffer pool and charge its frame to the given partition. */
+  auto FetchPage(page_id_t page_id, partition_id_t partition) -> Page * {
+    return FetchPgPartitionImp(page_id, partition);
+  }
+
+  /** @brief Unpin the target page from the buffer pool. */
+  auto UnpinPage(page_id_t page_id, bool is_dirty) -> bool { return UnpinPgImp(page_id, is_dirty); }
+
+  /** @brief Flush the target page to disk. */
+  auto FlushPage(page_id_t page_id) -> bool { return FlushPgImp(page_id); }
+
+  /** @brief Flush all the pages in the buffer pool to disk. */
+  void FlushAllPages() { FlushAllPgsImp(); }
+
+  /** @brief Delete a page from the buffer pool. */
+  auto DeletePage(page_id_t page_id) -> bool { return DeletePgImp(page_id); }
+
+  /**
+   * @brief Reserve a run of size contiguous page ids for one owner (e.g. one index). The pages of the run are
+   * created later, one at a time, by passing the reserved id as the hint of NewPage(page_id, hint).
+   * @return the first page id of the run, or INVALID_PAGE_ID if extents are not supported
+   */
+  auto ReserveExtent(int size) -> page_id_t { return ReserveExtentImp(size); }
+
+  /** @brief Give back the reserved ids in [first, first + size) that were never created. */
+  void ReleaseExtent(page_id_t first, int size) { ReleaseExtentImp(first, size); }
+
+  /**
+   * @brief Create a named partition of the buffer pool, e.g. one per index, with a quota of frames: pages of
+   * other partitions never evict its pages while it holds at most min_frames frames, and once it holds
+   * max_frames frames it evicts its own pages instead of taking more frames. Calling it again with the same
+   * name updates the quota.
+   * @return the partition id, DEFAULT_PARTITION_ID if partitions are not supported, or INVALID_PARTITION_ID if
+   * the guaranteed minimums would exceed the pool size
+   */
+  auto CreatePartition(const std::string &name, size_t min_frames, size_t max_frames) -> partition_id_t {
+    return CreatePartitionImp(name, min_frames, max_frames);
+  }
+
+  /** @return size of the buffer pool */
+  virtual auto GetPoolSize() -> size_t = 0;
+
+ protected:
+  /**
+   * Fetch the requested page from the buffer pool.
+   * @param page_id id of page to be fetched
+   * @return the requested page
+   */
+  virtual auto FetchPgImp(page_id_t page_id) -> Page * = 0;
+
+  /**
+   * Unpin the target page from the buffer pool.
+   * @param page_id id of page to be unpinned
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  virtual auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool = 0;
+
+  /**
+   * Flushes the target page to disk.
+   * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
+   * @return false if the page could not be found in the page table, true otherwise
+   */
+  virtual auto FlushPgImp(page_id_t page_id) -> bool = 0;
+
+  /**
+   * Creates a new page in the buffer pool.
+   * @param[out] page_id id of created page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  virtual auto NewPgImp(page_id_t *page_id) -> Page * = 0;
+
+  /**
+   * Creates a new page in the buffer pool, placing it close to hint if the implementation tracks free space.
+   * The default implementation ignores the hint and the partition.
+   * @param[out] page_id id of created page
+   * @param hint page id the new page should be physically close to, or INVALID_PAGE_ID
+   * @param partition partition to charge the frame to, or INVALID_PARTITION_ID for the default one
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  virtual auto NewPgNearImp(page_id_t *page_id, __attribute__((unused)) page_id_t hint,
+                            __attribute__((unused)) partition_id_t partition) -> Page * {
+    return NewPgImp(page_id);
+  }
+
+  /**
+   * Creates n new pages. The default implementation creates them one by one with NewPgNearImp(), so their ids
+   * are not necessarily contiguous, and deletes them again if one cannot be created.
+   * @param n number of pages to create
+   * @param[out] page_ids ids of the created pages
+   * @param[out] pages the created pages
+   * @param partition partition to charge the frames to, or INVALID_PARTITION_ID for the default one
+   * @return false if n pages could not be created
+   */
+  virtual auto NewPgsImp(size_t n, page_id_t *page_ids, Page **pages, partition_id_t partition) -> bool {
+    for (size_t i = 0; i < n; ++i) {
+      pages[i] = NewPgNearImp(&page_ids[i], i > 0 ? page_ids[i - 1] : INVALID_PAGE_ID, partition);
+      if (pages[i] == nullptr) {
+        for (size_t j = 0; j < i; ++j) {
+          UnpinPgImp(page_ids[j], false);
+          DeletePgImp(page_ids[j]);
+        }
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Fetches the requested page and charges its frame to partition. The default implementation has no partitions.
+   * @param page_id id of page to be fetched
+   * @param partition partition of the page, or INVALID_PARTITION_ID to keep the current one
+   * @return the requested page
+   */
+  virtual auto FetchPgPartitionImp(page_id_t page_id, __attribute__((unused)) partition_id_t partition) -> Page * {
+    return FetchPgImp(page_id);
+  }
+
+  /**
+   * Creates or updates a partition. The default implementation has a single partition.
+   */
+  virtual auto CreatePartitionImp(__attribute__((unused)) const std::string &name,
+                                  __attribute__((unused)) size_t min_frames,
+                                  __attribute__((unused)) size_t max_frames) -> partition_id_t {
+    return DEFAULT_PARTITION_ID;
+  }
+
+  /**
+   * Reserves size contiguous page ids. The default implementation does not support extents.
+   * @return the first reserved page id, or INVALID_PAGE_ID
+   */
+  virtual auto ReserveExtentImp(__attribute__((unused)) int size) -> page_id_t { return INVALID_PAGE_ID; }
+
+  /**
+   * Releases the reserved page ids in [first, first + size) that were never created.
+   */
+  virtual void ReleaseExtentImp(__attribute__((unused)) page_id_t first, __attribute__((unused)) int size) {}
+
+  /**
+   * Deletes a page from the buffer pool.
+   * @param page_id id of page to be deleted
+   * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
+   */
+  virtual auto DeletePgImp(page_id_t page_id) -> bool = 0;
+
+  /**
+   * Flushes all the pages in the buffer pool to disk.
+   */
+  virtual void FlushAllPgsImp() = 0;
+};
+}  // namespace bustub
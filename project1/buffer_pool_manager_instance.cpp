@@ -12,18 +12,32 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/access_trace.h"
 #include "common/exception.h"
 #include "common/macros.h"
+#include "common/metrics.h"
 
 namespace bustub {
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, size_t replacer_k,
                                                      LogManager *log_manager)
     : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
-  // we allocate a consecutive memory space for the buffer pool
-  pages_ = new Page[pool_size_];
+  // we allocate the buffer pool in chunks of FRAME_CHUNK_SIZE frames, so that it can grow and shrink
+  AddChunks(pool_size_);
   page_table_ = new ExtendibleHashTable<page_id_t, frame_id_t>(bucket_size_);
   replacer_ = new LRUKReplacer(pool_size, replacer_k);
+  replacer_k_ = replacer_k;
+  partitions_.push_back(Partition{"default", 0, std::numeric_limits<size_t>::max()});
+  frame_partition_.resize(pool_size_, DEFAULT_PARTITION_ID);
 
   // Initially, every page is in the free list.
   for (size_t i = 0; i < pool_size_; ++i) {
@@ -34,204 +48,348 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManag
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
-  delete[] pages_;
   delete page_table_;
   delete replacer_;
 }
 
 auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
-  std::scoped_lock<std::mutex> lock(latch_);
+  return NewPgNearImp(page_id, INVALID_PAGE_ID, INVALID_PARTITION_ID);
+}
 
-  frame_id_t frame_id;
-  bool found_frame = false;
+auto BufferPoolManagerInstance::NewPgNearImp(page_id_t *page_id, page_id_t hint, partition_id_t partition)
+    -> Page * {
+  LatchGuard lock(latch_);
 
-  // 1. 尝试从 free_list_ 获取
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
-    found_frame = true;
-  } else {
-    // 2. 尝试从 replacer_ 驱逐
-    if (replacer_->Evict(&frame_id)) {
-      found_frame = true;
-      page_id_t old_page_id = pages_[frame_id].GetPageId();
-
-      // 2a. 如果是脏页，写回磁盘
-      if (pages_[frame_id].IsDirty()) {
-        disk_manager_->WritePage(old_page_id, pages_[frame_id].GetData());
-        pages_[frame_id].is_dirty_ = false;
-      }
-      // 2b. 从 page_table_ 移除
-      page_table_->Remove(old_page_id);
-    }
-  }
-
-  // 3. 如果没有空闲帧 (所有帧都被 pin)，返回 nullptr
-  if (!found_frame) {
+  // 1. 从 free_list_ 或 replacer_ 获取一个帧；如果没有空闲帧 (所有帧都被 pin)，返回 nullptr
+  frame_id_t frame_id;
+  page_id_t victim;
+  bool victim_dirty;
+  if (!AcquireFrame(partition == INVALID_PARTITION_ID ? DEFAULT_PARTITION_ID : partition, &frame_id, &victim,
+                    &victim_dirty)) {
+    AccessTracer::Trace(AccessTraceOp::NEW, INVALID_PAGE_ID, ACCESS_TRACE_FAILED, INVALID_PAGE_ID, 0);
     return nullptr;
   }
 
-  // 4. 分配新 page_id 并设置新页
-  *page_id = AllocatePage();
+  // 2. 分配新 page_id（优先复用靠近 hint 的空闲页）并设置新页
+  *page_id = AllocatePage(hint);
 
-  // 5. 更新元数据和 Page 对象
+  // 3. 更新元数据和 Page 对象
   page_table_->Insert(*page_id, frame_id);
   replacer_->RecordAccess(frame_id);
   replacer_->SetEvictable(frame_id, false);  // 新页/获取的页默认不可驱逐
 
-  pages_[frame_id].ResetMemory();
+  GetFrame(frame_id).ResetMemory();
   // pages_[frame_id].SetPageId(*page_id); // 错误行
-  pages_[frame_id].page_id_ = *page_id;  // ** 修正 **
-  pages_[frame_id].pin_count_ = 1;         // Pin 计数为 1
-  pages_[frame_id].is_dirty_ = false;     // 新页是干净的
+  GetFrame(frame_id).page_id_ = *page_id;  // ** 修正 **
+  GetFrame(frame_id).pin_count_ = 1;         // Pin 计数为 1
+  GetFrame(frame_id).SetDirty(false);        // 新页是干净的
 
-  return &pages_[frame_id];
+  AccessTracer::Trace(AccessTraceOp::NEW, *page_id, victim_dirty ? ACCESS_TRACE_VICTIM_DIRTY : 0, victim, 1);
+  return &GetFrame(frame_id);
+}
+
+auto BufferPoolManagerInstance::NewPgsImp(size_t n, page_id_t *page_ids, Page **pages, partition_id_t partition)
+    -> bool {
+  LatchGuard lock(latch_);
+  if (n == 0) {
+    return true;
+  }
+  if (partition == INVALID_PARTITION_ID) {
+    partition = DEFAULT_PARTITION_ID;
+  }
+
+  // 1. 先拿到 n 个帧；不够时把已经拿到的帧还回 free_list_，一页也不创建
+  std::vector<frame_id_t> frames;
+  std::vector<std::pair<page_id_t, bool>> victims;
+  frames.reserve(n);
+  victims.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    frame_id_t frame_id;
+    page_id_t victim;
+    bool victim_dirty;
+    if (!AcquireFrame(partition, &frame_id, &victim, &victim_dirty)) {
+      for (frame_id_t taken : frames) {
+        partitions_[partition].frames_--;
+        GetFrame(taken).page_id_ = INVALID_PAGE_ID;
+        free_list_.push_front(taken);
+      }
+      AccessTracer::Trace(AccessTraceOp::NEW, INVALID_PAGE_ID, ACCESS_TRACE_FAILED, INVALID_PAGE_ID, 0);
+      return false;
+    }
+    frames.push_back(frame_id);
+    victims.emplace_back(victim, victim_dirty);
+  }
+
+  // 2. 一次分配 n 个连续的 page id，再像 NewPgNearImp() 一样设置每个新页
+  page_id_t first = AllocateRun(static_cast<int>(n));
+  for (size_t i = 0; i < n; ++i) {
+    frame_id_t frame_id = frames[i];
+    page_ids[i] = first + static_cast<page_id_t>(i);
+    page_table_->Insert(page_ids[i], frame_id);
+    replacer_->RecordAccess(frame_id);
+    replacer_->SetEvictable(frame_id, false);
+
+    Page &page = GetFrame(frame_id);
+    page.ResetMemory();
+    page.page_id_ = page_ids[i];
+    page.pin_count_ = 1;
+    page.SetDirty(false);
+    pages[i] = &page;
+    AccessTracer::Trace(AccessTraceOp::NEW, page_ids[i], victims[i].second ? ACCESS_TRACE_VICTIM_DIRTY : 0,
+                        victims[i].first, 1);
+  }
+  return true;
 }
 
 auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
-  std::scoped_lock<std::mutex> lock(latch_);
+  return FetchPgPartitionImp(page_id, INVALID_PARTITION_ID);
+}
+
+auto BufferPoolManagerInstance::FetchPgPartitionImp(page_id_t page_id, partition_id_t partition) -> Page * {
+  // 计时包括等待 latch_ 的时间
+  BUSTUB_METRIC_TIMER_START(start);
+  LatchGuard lock(latch_);
 
   frame_id_t frame_id;
 
   // 1. 尝试在 page_table_ 中查找
   if (page_table_->Find(page_id, frame_id)) {
-    // 页面在缓冲池中
-    pages_[frame_id].pin_count_++;
+    // 页面在缓冲池中；调用者指定了别的分区时，把这一帧记到那个分区上
+    if (partition != INVALID_PARTITION_ID && frame_partition_[frame_id] != partition) {
+      partitions_[frame_partition_[frame_id]].frames_--;
+      partitions_[partition].frames_++;
+      frame_partition_[frame_id] = partition;
+    }
+    uint32_t pin_count = ++GetFrame(frame_id).pin_count_;
     replacer_->RecordAccess(frame_id);
     replacer_->SetEvictable(frame_id, false);  // Pin 住，不可驱逐
-    return &pages_[frame_id];
+    AccessTracer::Trace(AccessTraceOp::FETCH, page_id, ACCESS_TRACE_HIT, INVALID_PAGE_ID, pin_count);
+    BUSTUB_METRIC_COUNT("bpm.fetch_hit", 1);
+    BUSTUB_METRIC_TIMER_RECORD(start, "bpm.fetch_hit_ns");
+    return &GetFrame(frame_id);
   }
 
-  // 2. 页面不在缓冲池中，需要获取一个帧
-  bool found_frame = false;
-  // 2a. 尝试从 free_list_ 获取
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
-    found_frame = true;
-  } else {
-    // 2b. 尝试从 replacer_ 驱逐
-    if (replacer_->Evict(&frame_id)) {
-      found_frame = true;
-      page_id_t old_page_id = pages_[frame_id].GetPageId();
-
-      // 如果是脏页，写回磁盘
-      if (pages_[frame_id].IsDirty()) {
-        disk_manager_->WritePage(old_page_id, pages_[frame_id].GetData());
-        pages_[frame_id].is_dirty_ = false;
-      }
-      // 从 page_table_ 移除
-      page_table_->Remove(old_page_id);
-    }
-  }
-
-  // 3. 如果没有可用的帧 (所有帧都被 pin)，返回 nullptr
-  if (!found_frame) {
+  // 2. 页面不在缓冲池中，需要获取一个帧；如果没有可用的帧 (所有帧都被 pin)，返回 nullptr
+  page_id_t victim;
+  bool victim_dirty;
+  if (!AcquireFrame(partition == INVALID_PARTITION_ID ? DEFAULT_PARTITION_ID : partition, &frame_id, &victim,
+                    &victim_dirty)) {
+    AccessTracer::Trace(AccessTraceOp::FETCH, page_id, ACCESS_TRACE_FAILED, INVALID_PAGE_ID, 0);
+    BUSTUB_METRIC_COUNT("bpm.fetch_no_frame", 1);
     return nullptr;
   }
 
-  // 4. 从磁盘读取页面到帧中
-  disk_manager_->ReadPage(page_id, pages_[frame_id].GetData());
+  // 3. 从磁盘读取页面到帧中
+  disk_manager_->ReadPage(page_id, GetFrame(frame_id).GetData());
 
-  // 5. 更新元数据和 Page 对象
+  // 4. 更新元数据和 Page 对象；WarmUp() 正在读同一页时，让它放弃自己读到的副本
   page_table_->Insert(page_id, frame_id);
+  warming_pages_.erase(page_id);
   replacer_->RecordAccess(frame_id);
   replacer_->SetEvictable(frame_id, false);
 
   // pages_[frame_id].SetPageId(page_id); // 错误行
-  pages_[frame_id].page_id_ = page_id;  // ** 修正 **
-  pages_[frame_id].pin_count_ = 1;
-  pages_[frame_id].is_dirty_ = false;
-
-  return &pages_[frame_id];
+  GetFrame(frame_id).page_id_ = page_id;  // ** 修正 **
+  GetFrame(frame_id).pin_count_ = 1;
+  GetFrame(frame_id).SetDirty(false);
+
+  AccessTracer::Trace(AccessTraceOp::FETCH, page_id, victim_dirty ? ACCESS_TRACE_VICTIM_DIRTY : 0, victim, 1);
+  BUSTUB_METRIC_COUNT("bpm.fetch_miss", 1);
+  BUSTUB_METRIC_TIMER_RECORD(start, "bpm.fetch_miss_ns");
+  return &GetFrame(frame_id);
 }
 
 auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
-  std::scoped_lock<std::mutex> lock(latch_);
+  LatchGuard lock(latch_);
 
   frame_id_t frame_id;
+  uint8_t trace_flags = is_dirty ? ACCESS_TRACE_DIRTY : 0;
   // 检查页是否在缓冲池中
   if (!page_table_->Find(page_id, frame_id)) {
+    AccessTracer::Trace(AccessTraceOp::UNPIN, page_id, trace_flags | ACCESS_TRACE_FAILED, INVALID_PAGE_ID, 0);
     return false;
   }
 
   // 检查 pin_count
-  if (pages_[frame_id].GetPinCount() == 0) {
+  if (GetFrame(frame_id).GetPinCount() == 0) {
+    AccessTracer::Trace(AccessTraceOp::UNPIN, page_id, trace_flags | ACCESS_TRACE_FAILED, INVALID_PAGE_ID, 0);
     return false;
   }
 
-  // 减少 pin_count
-  pages_[frame_id].pin_count_--;
-
   // 更新 dirty 标志
   // 只有当调用者标记为 dirty 时才更新。如果它已经是 dirty，保持 dirty。
   if (is_dirty) {
-    pages_[frame_id].is_dirty_ = true;
+    GetFrame(frame_id).SetDirty(true);
   }
 
+  // 减少 pin_count；Page::Pin()/Unpin() 可能同时在不持有 latch_ 的情况下修改它，所以按原子操作的结果判断
   // 如果 pin_count 降为 0，设置其为可驱逐
-  if (pages_[frame_id].GetPinCount() == 0) {
+  uint32_t pin_count = GetFrame(frame_id).pin_count_.fetch_sub(1) - 1;
+  if (pin_count == 0) {
     replacer_->SetEvictable(frame_id, true);
   }
 
+  AccessTracer::Trace(AccessTraceOp::UNPIN, page_id, trace_flags, INVALID_PAGE_ID, pin_count);
   return true;
 }
 
 auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
-  std::scoped_lock<std::mutex> lock(latch_);
-
+  Page *page;
   frame_id_t frame_id;
-  // 检查页是否在缓冲池中
-  if (!page_table_->Find(page_id, frame_id)) {
-    return false;
-  }
+  {
+    LatchGuard lock(latch_);
 
-  // 将页面数据写回磁盘
-  disk_manager_->WritePage(page_id, pages_[frame_id].GetData());
-
-  // 刷新后，页面不再是 dirty
-  pages_[frame_id].is_dirty_ = false;
+    // 检查页是否在缓冲池中
+    if (!page_table_->Find(page_id, frame_id)) {
+      return false;
+    }
+    // pin 住这一帧：写盘时不持有 latch_，这期间它不能被淘汰
+    page = &GetFrame(frame_id);
+    PinFrame(frame_id);
+  }
 
+  // 从页的快照写回磁盘，写者只在拷贝期间被阻塞
+  WritePageSnapshot(page);
+  // 用未跟踪的 UnpinFrame() 与上面的 PinFrame() 配对，免得跟踪中出现没有对应 FETCH 的 UNPIN
+  LatchGuard lock(latch_);
+  UnpinFrame(frame_id);
   return true;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
-  std::scoped_lock<std::mutex> lock(latch_);
+  std::vector<frame_id_t> frames;
+  {
+    LatchGuard lock(latch_);
+    // 干净的页和磁盘上一致，只需要写回脏页位图中置位的帧
+    frames = CollectDirtyFrames(std::numeric_limits<size_t>::max());
+  }
+  FlushFrames(frames);
+}
 
-  // 遍历所有帧
-  for (size_t i = 0; i < pool_size_; ++i) {
-    page_id_t page_id = pages_[i].GetPageId();
-    // 如果帧中有一个有效的页面
-    if (page_id != INVALID_PAGE_ID) {
-      // 强制刷新
-      disk_manager_->WritePage(page_id, pages_[i].GetData());
-      pages_[i].is_dirty_ = false;
+auto BufferPoolManagerInstance::FlushSome(size_t max_pages) -> size_t {
+  std::vector<frame_id_t> frames;
+  {
+    LatchGuard lock(latch_);
+    frames = CollectDirtyFrames(max_pages);
+  }
+  return FlushFrames(frames);
+}
+
+auto BufferPoolManagerInstance::CollectDirtyFrames(size_t max_pages) -> std::vector<frame_id_t> {
+  std::vector<frame_id_t> frames;
+  size_t num_chunks = chunks_.size();
+  size_t start = flush_cursor_;
+  // 从上次停下的块开始轮转，逐字扫描位图：没有脏页的块只需读一个字
+  for (size_t n = 0; n < num_chunks && frames.size() < max_pages; ++n) {
+    size_t chunk = (start + n) % num_chunks;
+    uint64_t dirty = chunks_[chunk]->dirty_;
+    while (dirty != 0 && frames.size() < max_pages) {
+      frames.push_back(static_cast<frame_id_t>(chunk * FRAME_CHUNK_SIZE + __builtin_ctzll(dirty)));
+      dirty &= dirty - 1;
     }
+    // 这个块还有没写完的脏页时，下次从它继续
+    flush_cursor_ = dirty != 0 ? chunk : (chunk + 1) % num_chunks;
+  }
+  return frames;
+}
+
+auto BufferPoolManagerInstance::FlushFrames(const std::vector<frame_id_t> &frames) -> size_t {
+  size_t flushed = 0;
+  // 分批 pin 住要写的帧，避免一次 pin 住太多帧让 NewPage/FetchPage 找不到空闲帧
+  for (size_t first = 0; first < frames.size(); first += FLUSH_BATCH_SIZE) {
+    size_t last = std::min(first + FLUSH_BATCH_SIZE, frames.size());
+    std::vector<std::pair<frame_id_t, Page *>> batch;
+    {
+      LatchGuard lock(latch_);
+      for (size_t i = first; i < last; ++i) {
+        // 收集之后这一帧可能已经被写回、淘汰或者随 Resize() 释放
+        if (static_cast<size_t>(frames[i]) < pool_size_ && GetFrame(frames[i]).IsDirty()) {
+          PinFrame(frames[i]);
+          batch.emplace_back(frames[i], &GetFrame(frames[i]));
+        }
+      }
+    }
+    for (auto &[frame_id, page] : batch) {
+      WritePageSnapshot(page);
+    }
+    LatchGuard lock(latch_);
+    for (auto &[frame_id, page] : batch) {
+      UnpinFrame(frame_id);
+    }
+    flushed += batch.size();
+  }
+  return flushed;
+}
+
+void BufferPoolManagerInstance::WritePageSnapshot(Page *page) {
+  std::unique_ptr<StagingBuffer> buffer;
+  {
+    LatchGuard lock(staging_latch_);
+    if (!staging_buffers_.empty()) {
+      buffer = std::move(staging_buffers_.back());
+      staging_buffers_.pop_back();
+    }
+  }
+  if (buffer == nullptr) {
+    buffer = std::make_unique<StagingBuffer>();
+  }
+
+  // 只在拷贝期间持有页的读锁；先清除 dirty：拷贝之后的修改会在 unpin 时重新标记
+  page->RLatch();
+  page->SetDirty(false);
+  uint64_t seq = page->snapshot_seq_.fetch_add(1) + 1;
+  memcpy(buffer->data_, page->GetData(), BUSTUB_PAGE_SIZE);
+  page->RUnlatch();
+  disk_manager_->WritePage(page->GetPageId(), buffer->data_);
+  // 同一页可能同时被几处刷写：更新的拷贝已经取走时，这次写的旧内容可能后落盘，重新标记为脏让它再写一次
+  if (page->snapshot_seq_.load() != seq) {
+    page->SetDirty(true);
+  }
+
+  LatchGuard lock(staging_latch_);
+  staging_buffers_.push_back(std::move(buffer));
+}
+
+void BufferPoolManagerInstance::PinFrame(frame_id_t frame_id) {
+  if (GetFrame(frame_id).pin_count_++ == 0) {
+    replacer_->SetEvictable(frame_id, false);
+  }
+}
+
+void BufferPoolManagerInstance::UnpinFrame(frame_id_t frame_id) {
+  if (GetFrame(frame_id).pin_count_.fetch_sub(1) == 1) {
+    replacer_->SetEvictable(frame_id, true);
   }
 }
 
 auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
-  std::scoped_lock<std::mutex> lock(latch_);
+  LatchGuard lock(latch_);
 
   frame_id_t frame_id;
   // 1. 检查页是否在缓冲池中
   if (page_table_->Find(page_id, frame_id)) {
     // 2. 如果在缓冲池中，检查 pin 计数
-    if (pages_[frame_id].GetPinCount() > 0) {
+    if (GetFrame(frame_id).GetPinCount() > 0) {
       // 页面正在被使用，无法删除
+      AccessTracer::Trace(AccessTraceOp::DELETE, page_id, ACCESS_TRACE_HIT | ACCESS_TRACE_FAILED, INVALID_PAGE_ID,
+                          GetFrame(frame_id).GetPinCount());
       return false;
     }
+    AccessTracer::Trace(AccessTraceOp::DELETE, page_id, ACCESS_TRACE_HIT, INVALID_PAGE_ID, 0);
     // 3. 从缓冲池中移除
     page_table_->Remove(page_id);
+    partitions_[frame_partition_[frame_id]].frames_--;
     replacer_->Remove(frame_id);      // 从 replacer 移除
     free_list_.push_back(frame_id);  // 归还到 free_list
 
     // 重置 Page 对象元数据
-    pages_[frame_id].ResetMemory();
+    GetFrame(frame_id).ResetMemory();
     // pages_[frame_id].SetPageId(INVALID_PAGE_ID); // 错误行
-    pages_[frame_id].page_id_ = INVALID_PAGE_ID;  // ** 修正 **
-    pages_[frame_id].pin_count_ = 0;
-    pages_[frame_id].is_dirty_ = false;
+    GetFrame(frame_id).page_id_ = INVALID_PAGE_ID;  // ** 修正 **
+    GetFrame(frame_id).pin_count_ = 0;
+    GetFrame(frame_id).SetDirty(false);
+  } else {
+    AccessTracer::Trace(AccessTraceOp::DELETE, page_id, 0, INVALID_PAGE_ID, 0);
   }
 
   // 4. 不管页是否在缓冲池中，都告诉 disk_manager 释放该页
@@ -239,6 +397,478 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   return true;
 }
 
-auto BufferPoolManagerInstance::AllocatePage() -> page_id_t { return next_page_id_++; }
+auto BufferPoolManagerInstance::Resize(size_t pool_size) -> bool {
+  LatchGuard lock(latch_);
+  BUSTUB_ASSERT(pool_size > 0, "buffer pool needs at least one frame");
+
+  size_t old_pool_size = pool_size_;
+  if (pool_size >= old_pool_size) {
+    AddChunks(pool_size);
+    frame_partition_.resize(pool_size, DEFAULT_PARTITION_ID);
+    replacer_->Resize(pool_size);
+    for (size_t i = old_pool_size; i < pool_size; ++i) {
+      free_list_.emplace_back(static_cast<frame_id_t>(i));
+    }
+    pool_size_ = pool_size;
+    return true;
+  }
+
+  // 缩小：要释放的帧都不能被 pin，否则什么都不做
+  for (size_t i = pool_size; i < old_pool_size; ++i) {
+    if (GetFrame(i).GetPinCount() > 0) {
+      return false;
+    }
+  }
+  for (size_t i = pool_size; i < old_pool_size; ++i) {
+    Page &page = GetFrame(i);
+    if (page.GetPageId() == INVALID_PAGE_ID) {
+      continue;
+    }
+    if (page.IsDirty()) {
+      disk_manager_->WritePage(page.GetPageId(), page.GetData());
+    }
+    page_table_->Remove(page.GetPageId());
+    partitions_[frame_partition_[i]].frames_--;
+    replacer_->Remove(static_cast<frame_id_t>(i));
+    page.page_id_ = INVALID_PAGE_ID;
+    page.SetDirty(false);
+  }
+  free_list_.remove_if([pool_size](frame_id_t frame_id) { return static_cast<size_t>(frame_id) >= pool_size; });
+  replacer_->Resize(pool_size);
+  frame_partition_.resize(pool_size);
+  pool_size_ = pool_size;
+  chunks_.resize((pool_size + FRAME_CHUNK_SIZE - 1) / FRAME_CHUNK_SIZE);
+  return true;
+}
+
+void BufferPoolManagerInstance::AddChunks(size_t pool_size) {
+  while (chunks_.size() * FRAME_CHUNK_SIZE < pool_size) {
+    auto chunk = std::make_unique<FrameChunk>();
+    for (size_t i = 0; i < FRAME_CHUNK_SIZE; ++i) {
+      chunk->pages_[i].data_ = chunk->data_ + i * BUSTUB_PAGE_SIZE;
+      chunk->pages_[i].dirty_bits_ = &chunk->dirty_;
+      chunk->pages_[i].dirty_mask_ = uint64_t{1} << i;
+    }
+    chunks_.push_back(std::move(chunk));
+  }
+}
+
+auto BufferPoolManagerInstance::AcquireFrame(partition_id_t partition, frame_id_t *frame_id, page_id_t *victim_page_id,
+                                             bool *victim_dirty) -> bool {
+  Partition &owner = partitions_[partition];
+  *victim_page_id = INVALID_PAGE_ID;
+  *victim_dirty = false;
+
+  // 1. 分区没有达到上限时，优先从 free_list_ 获取
+  if (owner.frames_ < owner.max_frames_ && !free_list_.empty()) {
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+  } else if (!EvictFor(partition, frame_id)) {
+    // 2. 分区达到上限、但自己的页全被 pin 住时，仍然可以用空闲帧
+    if (free_list_.empty()) {
+      return false;
+    }
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+  } else {
+    // 3. 淘汰出来的帧：如果是脏页，写回磁盘，并从 page_table_ 和原分区中移除
+    Page &victim = GetFrame(*frame_id);
+    BUSTUB_METRIC_COUNT("bpm.evict", 1);
+    *victim_page_id = victim.GetPageId();
+    *victim_dirty = victim.IsDirty();
+    if (victim.IsDirty()) {
+      BUSTUB_METRIC_TIMER_START(write_start);
+      disk_manager_->WritePage(victim.GetPageId(), victim.GetData());
+      victim.SetDirty(false);
+      BUSTUB_METRIC_TIMER_RECORD(write_start, "bpm.evict_write_back_ns");
+    }
+    page_table_->Remove(victim.GetPageId());
+    partitions_[frame_partition_[*frame_id]].frames_--;
+  }
+
+  frame_partition_[*frame_id] = partition;
+  owner.frames_++;
+
+  // 4. 空闲帧低于低水位时，一次性预先淘汰一批，后面的缺页就能直接拿到空闲帧
+  if (free_list_.size() < low_watermark_) {
+    RefillFreeList();
+  }
+  return true;
+}
+
+void BufferPoolManagerInstance::RefillFreeList() {
+  // 只淘汰干净的页，脏页留给 FlushSome() 在不持有 latch_ 时写回；也不让分区低于保底帧数
+  std::vector<size_t> taken(partitions_.size(), 0);
+  std::vector<frame_id_t> victims;
+  replacer_->EvictBatch(eviction_batch_size_, &victims, [&](frame_id_t frame) {
+    if (GetFrame(frame).IsDirty()) {
+      return false;
+    }
+    const Partition &quota = partitions_[frame_partition_[frame]];
+    if (quota.frames_ - taken[frame_partition_[frame]] <= quota.min_frames_) {
+      return false;
+    }
+    taken[frame_partition_[frame]]++;
+    return true;
+  });
+
+  BUSTUB_METRIC_COUNT("bpm.evict", victims.size());
+  for (frame_id_t frame_id : victims) {
+    Page &victim = GetFrame(frame_id);
+    AccessTracer::Trace(AccessTraceOp::EVICT, victim.GetPageId(), 0, INVALID_PAGE_ID, 0);
+    page_table_->Remove(victim.GetPageId());
+    partitions_[frame_partition_[frame_id]].frames_--;
+    victim.page_id_ = INVALID_PAGE_ID;
+    free_list_.push_back(frame_id);
+  }
+}
+
+void BufferPoolManagerInstance::SetFreeFrameWatermark(size_t low_watermark, size_t batch_size) {
+  LatchGuard lock(latch_);
+  low_watermark_ = low_watermark;
+  eviction_batch_size_ = batch_size;
+}
+
+auto BufferPoolManagerInstance::EvictFor(partition_id_t partition, frame_id_t *frame_id) -> bool {
+  auto quota_of = [this](frame_id_t frame) -> const Partition & { return partitions_[frame_partition_[frame]]; };
+
+  // 1. 分区已经用满上限，只能淘汰自己的页
+  if (partitions_[partition].frames_ >= partitions_[partition].max_frames_) {
+    return replacer_->Evict(frame_id, [&](frame_id_t frame) { return frame_partition_[frame] == partition; });
+  }
+  // 2. 优先淘汰超出上限的分区的页（例如配额被调低之后）
+  if (replacer_->Evict(frame_id, [&](frame_id_t frame) {
+        const Partition &quota = quota_of(frame);
+        return quota.frames_ > quota.max_frames_;
+      })) {
+    return true;
+  }
+  // 3. 然后是超出保底帧数的分区的页，以及自己的页；不足保底帧数的分区受保护
+  return replacer_->Evict(frame_id, [&](frame_id_t frame) {
+    const Partition &quota = quota_of(frame);
+    return frame_partition_[frame] == partition || quota.frames_ > quota.min_frames_;
+  });
+}
+
+auto BufferPoolManagerInstance::CreatePartitionImp(const std::string &name, size_t min_frames, size_t max_frames)
+    -> partition_id_t {
+  LatchGuard lock(latch_);
+  BUSTUB_ASSERT(max_frames > 0 && min_frames <= max_frames, "invalid partition quota");
+
+  auto it = std::find_if(partitions_.begin(), partitions_.end(),
+                         [&name](const Partition &partition) { return partition.name_ == name; });
+  size_t reserved = min_frames;
+  for (const auto &partition : partitions_) {
+    if (partition.name_ != name) {
+      reserved += partition.min_frames_;
+    }
+  }
+  if (reserved > pool_size_) {
+    return INVALID_PARTITION_ID;
+  }
+
+  if (it == partitions_.end()) {
+    partitions_.push_back(Partition{name, min_frames, max_frames});
+    return static_cast<partition_id_t>(partitions_.size() - 1);
+  }
+  it->min_frames_ = min_frames;
+  it->max_frames_ = max_frames;
+  return static_cast<partition_id_t>(it - partitions_.begin());
+}
+
+auto BufferPoolManagerInstance::GetPartitionFrames(partition_id_t partition) -> size_t {
+  LatchGuard lock(latch_);
+  return partitions_[partition].frames_;
+}
+
+auto BufferPoolManagerInstance::AllocatePage(page_id_t hint) -> page_id_t {
+  // hint 是调用者预留的 extent 中的页时，直接分配这一页
+  if (hint != INVALID_PAGE_ID && reserved_pages_.erase(hint) != 0) {
+    return hint;
+  }
+
+  if (free_pages_.empty()) {
+    return next_page_id_++;
+  }
+
+  // 没有 hint 时复用最小的空闲页，让文件尽量紧凑
+  auto it = free_pages_.begin();
+  if (hint != INVALID_PAGE_ID) {
+    // 在 hint 两侧各找一个空闲页，取距离更近的那个
+    it = free_pages_.lower_bound(hint);
+    if (it == free_pages_.end()) {
+      it = std::prev(it);
+    } else if (it != free_pages_.begin() && hint - *std::prev(it) <= *it - hint) {
+      it = std::prev(it);
+    }
+  }
+  page_id_t page_id = *it;
+  free_pages_.erase(it);
+  // 被删除后又重新分配的页，WarmUp() 读到的是旧内容
+  warming_pages_.erase(page_id);
+  return page_id;
+}
+
+void BufferPoolManagerInstance::DeallocatePage(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID || page_id == HEADER_PAGE_ID || page_id >= next_page_id_) {
+    return;
+  }
+  free_pages_.insert(page_id);
+}
+
+auto BufferPoolManagerInstance::ReserveExtentImp(int size) -> page_id_t {
+  LatchGuard lock(latch_);
+  if (size <= 0) {
+    return INVALID_PAGE_ID;
+  }
+
+  page_id_t first = AllocateRun(size);
+  for (page_id_t page_id = first; page_id < first + size; ++page_id) {
+    reserved_pages_.insert(page_id);
+  }
+  return first;
+}
+
+auto BufferPoolManagerInstance::AllocateRun(int size) -> page_id_t {
+  // 先在空闲页中找一段长度为 size 的连续页
+  page_id_t first = INVALID_PAGE_ID;
+  int run = 0;
+  page_id_t prev = INVALID_PAGE_ID;
+  for (page_id_t page_id : free_pages_) {
+    run = (prev != INVALID_PAGE_ID && page_id == prev + 1) ? run + 1 : 1;
+    prev = page_id;
+    if (run == size) {
+      first = page_id - size + 1;
+      break;
+    }
+  }
+
+  if (first != INVALID_PAGE_ID) {
+    free_pages_.erase(free_pages_.find(first), free_pages_.upper_bound(first + size - 1));
+    // 与 AllocatePage() 相同：重新分配出去的页让 WarmUp() 放弃旧内容
+    for (page_id_t page_id = first; page_id < first + size; ++page_id) {
+      warming_pages_.erase(page_id);
+    }
+  } else {
+    // 否则从文件末尾划出一段
+    first = next_page_id_.fetch_add(size);
+  }
+  return first;
+}
+
+void BufferPoolManagerInstance::ReleaseExtentImp(page_id_t first, int size) {
+  LatchGuard lock(latch_);
+  for (page_id_t page_id = first; page_id < first + size; ++page_id) {
+    if (reserved_pages_.erase(page_id) != 0) {
+      free_pages_.insert(page_id);
+    }
+  }
+}
+
+auto BufferPoolManagerInstance::SaveFreePageMap(const std::string &file_name) -> bool {
+  LatchGuard lock(latch_);
+
+  page_id_t next_page_id = next_page_id_;
+  std::vector<char> bitmap((next_page_id + 7) / 8, 0);
+  for (const auto *pages : {&free_pages_, &reserved_pages_}) {
+    for (page_id_t page_id : *pages) {
+      bitmap[page_id / 8] |= static_cast<char>(1 << (page_id % 8));
+    }
+  }
+
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&next_page_id), sizeof(next_page_id));
+  out.write(bitmap.data(), static_cast<std::streamsize>(bitmap.size()));
+  return static_cast<bool>(out);
+}
+
+auto BufferPoolManagerInstance::LoadFreePageMap(const std::string &file_name) -> bool {
+  LatchGuard lock(latch_);
+
+  std::ifstream in(file_name, std::ios::binary);
+  page_id_t next_page_id;
+  if (!in.read(reinterpret_cast<char *>(&next_page_id), sizeof(next_page_id)) || next_page_id < 0) {
+    return false;
+  }
+  std::vector<char> bitmap((next_page_id + 7) / 8, 0);
+  if (!in.read(bitmap.data(), static_cast<std::streamsize>(bitmap.size()))) {
+    return false;
+  }
+
+  free_pages_.clear();
+  for (page_id_t page_id = 0; page_id < next_page_id; ++page_id) {
+    if ((bitmap[page_id / 8] & (1 << (page_id % 8))) != 0) {
+      free_pages_.insert(page_id);
+    }
+  }
+  next_page_id_ = std::max<page_id_t>(next_page_id_, next_page_id);
+  return true;
+}
+
+auto BufferPoolManagerInstance::SaveHotPages(const std::string &file_name) -> bool {
+  std::vector<std::pair<page_id_t, std::vector<size_t>>> hot_pages;
+  {
+    LatchGuard lock(latch_);
+    for (size_t i = 0; i < pool_size_; ++i) {
+      if (GetFrame(i).GetPageId() != INVALID_PAGE_ID) {
+        hot_pages.emplace_back(GetFrame(i).GetPageId(), replacer_->GetHistory(static_cast<frame_id_t>(i)));
+      }
+    }
+  }
+
+  // 文件格式：magic、页数，然后每页是 page_id、历史长度和历史时间戳（新的在前）
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  auto count = static_cast<uint32_t>(hot_pages.size());
+  out.write(reinterpret_cast<const char *>(&HOT_PAGES_MAGIC), sizeof(HOT_PAGES_MAGIC));
+  out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  for (const auto &[page_id, history] : hot_pages) {
+    auto history_size = static_cast<uint32_t>(history.size());
+    out.write(reinterpret_cast<const char *>(&page_id), sizeof(page_id));
+    out.write(reinterpret_cast<const char *>(&history_size), sizeof(history_size));
+    out.write(reinterpret_cast<const char *>(history.data()),
+              static_cast<std::streamsize>(history.size() * sizeof(size_t)));
+  }
+  return static_cast<bool>(out);
+}
+
+auto BufferPoolManagerInstance::WarmUp(const std::string &file_name, size_t num_threads) -> size_t {
+  struct HotPage {
+    page_id_t page_id_;
+    std::vector<size_t> history_;
+    frame_id_t frame_id_{-1};
+    Page *page_{nullptr};
+  };
+
+  std::ifstream in(file_name, std::ios::binary);
+  uint32_t magic;
+  uint32_t count;
+  if (!in.read(reinterpret_cast<char *>(&magic), sizeof(magic)) || magic != HOT_PAGES_MAGIC ||
+      !in.read(reinterpret_cast<char *>(&count), sizeof(count))) {
+    return 0;
+  }
+  // 文件内容不可信：页数和历史长度都只作为上限使用，不按它们一次性分配内存
+  std::vector<HotPage> hot_pages;
+  hot_pages.reserve(std::min<size_t>(count, pool_size_));
+  for (uint32_t i = 0; i < count; ++i) {
+    HotPage hot_page;
+    uint32_t history_size;
+    if (!in.read(reinterpret_cast<char *>(&hot_page.page_id_), sizeof(hot_page.page_id_)) ||
+        !in.read(reinterpret_cast<char *>(&history_size), sizeof(history_size))) {
+      return 0;
+    }
+    // replacer 只保留最近 k 次访问，更早的部分直接跳过
+    size_t kept = std::min<size_t>(history_size, replacer_k_);
+    hot_page.history_.resize(kept);
+    auto skipped = static_cast<std::streamsize>((history_size - kept) * sizeof(size_t));
+    if (!in.read(reinterpret_cast<char *>(hot_page.history_.data()),
+                 static_cast<std::streamsize>(kept * sizeof(size_t))) ||
+        in.ignore(skipped).gcount() != skipped) {
+      return 0;
+    }
+    hot_pages.push_back(std::move(hot_page));
+  }
+
+  // 按 page_id 排序，让磁盘上基本是顺序读
+  std::sort(hot_pages.begin(), hot_pages.end(),
+            [](const HotPage &a, const HotPage &b) { return a.page_id_ < b.page_id_; });
+
+  // 1. 持锁从 free_list_ 领取帧。帧离开了 free_list_ 又不在 page_table_ 中，别的线程看不到它。
+  //    没有分配出去的页（文件过期或属于别的数据库）跳过。返回 false 表示没有空闲帧了
+  auto claim = [this](HotPage *first, HotPage *last, std::vector<HotPage *> *batch) -> bool {
+    LatchGuard lock(latch_);
+    if (free_list_.empty()) {
+      return false;
+    }
+    frame_id_t frame_id;
+    for (HotPage *hot_page = first; hot_page != last && !free_list_.empty(); ++hot_page) {
+      page_id_t page_id = hot_page->page_id_;
+      if (page_id < 0 || page_id >= next_page_id_ || free_pages_.count(page_id) != 0 ||
+          reserved_pages_.count(page_id) != 0 || warming_pages_.count(page_id) != 0 ||
+          page_table_->Find(page_id, frame_id)) {
+        continue;
+      }
+      hot_page->frame_id_ = free_list_.front();
+      hot_page->page_ = &GetFrame(hot_page->frame_id_);
+      // 读盘期间 pin 住这一帧，防止 Resize() 把它所在的块释放掉
+      hot_page->page_->pin_count_ = 1;
+      free_list_.pop_front();
+      warming_pages_.insert(page_id);
+      batch->push_back(hot_page);
+    }
+    return true;
+  };
+
+  // 3. 持锁发布。读盘期间被 FetchPage 读入或被重新分配的页已经不在 warming_pages_ 中了，
+  //    读到的可能是它被写回之前的旧内容，放弃，帧还给 free_list_
+  auto publish = [this](std::vector<HotPage *> *batch) -> size_t {
+    auto last_access = [](const HotPage *hot_page) -> size_t {
+      return hot_page->history_.empty() ? 0 : hot_page->history_.front();
+    };
+    std::sort(batch->begin(), batch->end(),
+              [&](const HotPage *a, const HotPage *b) { return last_access(a) < last_access(b); });
+    size_t published = 0;
+    LatchGuard lock(latch_);
+    for (HotPage *hot_page : *batch) {
+      frame_id_t frame_id;
+      if (warming_pages_.erase(hot_page->page_id_) == 0 || free_pages_.count(hot_page->page_id_) != 0 ||
+          page_table_->Find(hot_page->page_id_, frame_id)) {
+        hot_page->page_->pin_count_ = 0;
+        free_list_.push_back(hot_page->frame_id_);
+        continue;
+      }
+      Page &page = *hot_page->page_;
+      page.page_id_ = hot_page->page_id_;
+      page.pin_count_ = 0;
+      page.SetDirty(false);
+      page_table_->Insert(hot_page->page_id_, hot_page->frame_id_);
+      frame_partition_[hot_page->frame_id_] = DEFAULT_PARTITION_ID;
+      partitions_[DEFAULT_PARTITION_ID].frames_++;
+      // 按最近访问时间从旧到新放入 replacer，保持原来的淘汰顺序
+      if (hot_page->history_.empty()) {
+        replacer_->RecordAccess(hot_page->frame_id_);
+      } else {
+        replacer_->RestoreHistory(hot_page->frame_id_, hot_page->history_);
+      }
+      replacer_->SetEvictable(hot_page->frame_id_, true);
+      ++published;
+    }
+    return published;
+  };
+
+  // 读线程只启动一次，轮流领取下一批并各自走完 1-3 步，批与批之间互不等待
+  std::atomic<size_t> next_batch{0};
+  std::atomic<bool> out_of_frames{false};
+  std::atomic<size_t> loaded{0};
+  auto reader = [&] {
+    std::vector<HotPage *> batch;
+    while (!out_of_frames) {
+      size_t begin = next_batch.fetch_add(WARM_UP_BATCH_SIZE);
+      if (begin >= hot_pages.size()) {
+        break;
+      }
+      size_t end = std::min(begin + WARM_UP_BATCH_SIZE, hot_pages.size());
+      batch.clear();
+      if (!claim(&hot_pages[begin], hot_pages.data() + end, &batch)) {
+        out_of_frames = true;
+        break;
+      }
+      // 2. 不持锁读盘
+      for (HotPage *hot_page : batch) {
+        disk_manager_->ReadPage(hot_page->page_id_, hot_page->page_->GetData());
+      }
+      loaded += publish(&batch);
+    }
+  };
+
+  size_t num_batches = (hot_pages.size() + WARM_UP_BATCH_SIZE - 1) / WARM_UP_BATCH_SIZE;
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < std::min(std::max<size_t>(num_threads, 1), num_batches); ++i) {
+    readers.emplace_back(reader);
+  }
+  for (auto &thread : readers) {
+    thread.join();
+  }
+  return loaded;
+}
 
 }  // namespace bustub
@@ -0,0 +1,409 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_instance.h
+//
+// Identification: src/include/buffer/buffer_pool_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/lru_k_replacer.h"
+#include "common/config.h"
+#include "common/rwlatch.h"
+#include "container/hash/extendible_hash_table.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ */
+class BufferPoolManagerInstance : public BufferPoolManager {
+ public:
+  /**
+   * @brief Creates a new BufferPoolManagerInstance.
+   * @param pool_size the size of the buffer pool
+   * @param disk_manager the disk manager
+   * @param replacer_k the lookback constant k for the LRU-K replacer
+   * @param log_manager the log manager (for testing only: nullptr = disable logging). Please ignore this for P1.
+   */
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, size_t replacer_k = LRUK_REPLACER_K,
+                            LogManager *log_manager = nullptr);
+
+  /**
+   * @brief Destroy an existing BufferPoolManagerInstance.
+   */
+  ~BufferPoolManagerInstance() override;
+
+  /** @brief Return the size (number of frames) of the buffer pool. */
+  auto GetPoolSize() -> size_t override { return pool_size_; }
+
+  /**
+   * @brief Grow or shrink the buffer pool to pool_size frames while it is in use.
+   *
+   * Growing adds chunks of FRAME_CHUNK_SIZE frames and puts the new frames on the free list. Shrinking writes back
+   * and evicts the pages in frames [pool_size, GetPoolSize()) and releases the chunks no longer needed; it fails
+   * without changing anything if one of these frames is pinned. The replacer is resized alongside, the page table
+   * adapts on its own.
+   *
+   * @param pool_size the new number of frames, at least 1
+   * @return false if the pool could not be shrunk because a frame to release is pinned
+   */
+  auto Resize(size_t pool_size) -> bool;
+
+  /**
+   * @brief Persist the free-page map, so that pages freed before a restart are reused after it.
+   *
+   * File format: next_page_id (4 bytes), then a bitmap with one bit per page id below next_page_id,
+   * where a set bit marks a free page. Reserved but never created extent pages are saved as free.
+   *
+   * @param file_name file to write the map to, usually next to the database file
+   * @return false if the file could not be written
+   */
+  auto SaveFreePageMap(const std::string &file_name) -> bool;
+
+  /**
+   * @brief Load a free-page map written by SaveFreePageMap(). Call before any page is allocated.
+   * @param file_name file to read the map from
+   * @return false if the file does not exist or is malformed
+   */
+  auto LoadFreePageMap(const std::string &file_name) -> bool;
+
+  /**
+   * @brief Persist the ids of the resident pages together with their LRU-K history, so that the next instance
+   * can be warmed up with WarmUp(). Call it periodically (e.g. at checkpoints) and at shutdown.
+   *
+   * @param file_name file to write the hot-page list to
+   * @return false if the file could not be written
+   */
+  auto SaveHotPages(const std::string &file_name) -> bool;
+
+  /**
+   * @brief Read the pages listed by SaveHotPages() into free frames and restore their replacer history.
+   *
+   * Pages are read in page id order, in batches of WARM_UP_BATCH_SIZE. num_threads readers take batches in
+   * turn, read them without holding the latch and publish each batch as soon as it is read, so WarmUp() can run
+   * while the pool already serves requests. Only free frames are used: pages brought in by traffic in the
+   * meantime are neither displaced nor read twice, and a page that traffic fetched or allocated while it was
+   * being read is dropped, since the copy read may be older than the one on disk by now. Pages that are not
+   * allocated are skipped, so load the free-page map with LoadFreePageMap() first.
+   *
+   * @param file_name file written by SaveHotPages()
+   * @param num_threads number of threads reading batches
+   * @return the number of pages loaded
+   */
+  auto WarmUp(const std::string &file_name, size_t num_threads = 4) -> size_t;
+
+  /**
+   * @brief Write back at most max_pages dirty pages. Successive calls continue where the previous one stopped, so
+   * calling it periodically (e.g. from a background flusher) paces the write-back of the whole pool.
+   * @return the number of pages written
+   */
+  auto FlushSome(size_t max_pages) -> size_t;
+
+  /**
+   * @brief Keep free frames ahead of demand: whenever a page takes a frame and fewer than low_watermark frames are
+   * left on the free list, up to batch_size pages are evicted in one pass over the replacer. Only clean pages of
+   * partitions above their guaranteed minimum are evicted this way; dirty pages are left to FlushSome(), which
+   * should run periodically alongside. low_watermark = 0 turns pre-eviction off, which is the default.
+   */
+  void SetFreeFrameWatermark(size_t low_watermark, size_t batch_size);
+
+  /** @brief Return the number of frames currently charged to a partition. */
+  auto GetPartitionFrames(partition_id_t partition) -> size_t;
+
+ protected:
+  /**
+   * @brief Create a new page in the buffer pool. Set page_id to the new page's id, or nullptr if all frames
+   * are currently in use and not evictable (in another word, pinned).
+   *
+   * You should pick the replacement frame from either the free list or the replacer (always find from the free list
+   * first), and then call the AllocatePage() method to get a new page id. If the replacement frame has a dirty page,
+   * you should write it back to the disk first. You also need to reset the memory and metadata for the new page.
+   *
+   * Remember to "Pin" the frame by calling replacer.SetEvictable(frame_id, false)
+   * so that the replacer wouldn't evict the frame before the buffer pool manager "Unpin"s it.
+   * Also, remember to record the access history of the frame in the replacer for the lru-k algorithm to work.
+   *
+   * @param[out] page_id id of created page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto NewPgImp(page_id_t *page_id) -> Page * override;
+
+  /**
+   * @brief Same as NewPgImp(), but the page id is taken from the free-page map as close to hint as possible,
+   * and the frame is charged to partition.
+   */
+  auto NewPgNearImp(page_id_t *page_id, page_id_t hint, partition_id_t partition) -> Page * override;
+
+  /**
+   * @brief Create n pages with contiguous page ids under a single acquisition of the latch. The ids come from a
+   * run of free pages if there is one, or from the end of the file otherwise, like ReserveExtentImp().
+   */
+  auto NewPgsImp(size_t n, page_id_t *page_ids, Page **pages, partition_id_t partition) -> bool override;
+
+  /**
+   * @brief Fetch the requested page from the buffer pool. Return nullptr if page_id needs to be fetched from the disk
+   * but all frames are currently in use and not evictable (in another word, pinned).
+   *
+   * First search for page_id in the buffer pool. If not found, pick a replacement frame from either the free list or
+   * the replacer (always find from the free list first), read the page from disk by calling disk_manager_->ReadPage(),
+   * and replace the old page in the frame. Similar to NewPgImp(), if the old page is dirty, you need to write it back
+   * to disk and update the metadata of the new page
+   *
+   * In addition, remember to disable eviction and record the access history of the frame like you did for NewPgImp().
+   *
+   * @param page_id id of page to be fetched
+   * @return nullptr if page_id cannot be fetched, otherwise pointer to the requested page
+   */
+  auto FetchPgImp(page_id_t page_id) -> Page * override;
+
+  /**
+   * @brief Same as FetchPgImp(), but a page read from disk is charged to partition, and a page already in the
+   * buffer pool is moved to partition, unless it is INVALID_PARTITION_ID.
+   */
+  auto FetchPgPartitionImp(page_id_t page_id, partition_id_t partition) -> Page * override;
+
+  /**
+   * @brief Unpin the target page from the buffer pool. If page_id is not in the buffer pool or its pin count is already
+   * 0, return false.
+   *
+   * Decrement the pin count of a page. If the pin count reaches 0, the frame should be evictable by the replacer.
+   * Also, set the dirty flag on the page to indicate if the page was modified.
+   *
+   * @param page_id id of page to be unpinned
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page is not in the page table or its pin count is <= 0 before this call, true otherwise
+   */
+  auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool override;
+
+  /**
+   * @brief Flush the target page to disk.
+   *
+   * Use the DiskManager::WritePage() method to flush a page to disk, REGARDLESS of the dirty flag.
+   * Unset the dirty flag of the page after flushing.
+   *
+   * The page is written from a copy taken under its read latch, and neither the page latch nor the buffer pool
+   * latch is held during the write, so writers of the page are only blocked for the copy. The caller must
+   * therefore not hold the page's write latch.
+   *
+   * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
+   * @return false if the page could not be found in the page table, true otherwise
+   */
+  auto FlushPgImp(page_id_t page_id) -> bool override;
+
+  /**
+   * @brief Flush all the dirty pages in the buffer pool to disk, from copies like FlushPgImp().
+   */
+  void FlushAllPgsImp() override;
+
+  /**
+   * @brief Delete a page from the buffer pool. If page_id is not in the buffer pool, do nothing and return true. If the
+   * page is pinned and cannot be deleted, return false immediately.
+   *
+   * After deleting the page from the page table, stop tracking the frame in the replacer and add the frame
+   * back to the free list. Also, reset the page's memory and metadata. Finally, you should call DeallocatePage() to
+   * return the page id to the free-page map.
+   *
+   * @param page_id id of page to be deleted
+   * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
+   */
+  auto DeletePgImp(page_id_t page_id) -> bool override;
+
+  /**
+   * @brief Reserve size contiguous page ids, taken from a run of free pages if there is one, or from the end of
+   * the file otherwise. Reserved ids are only handed out by AllocatePage() when they are passed as the hint.
+   */
+  auto ReserveExtentImp(int size) -> page_id_t override;
+
+  /**
+   * @brief Move the still reserved ids in [first, first + size) to the free-page map.
+   */
+  void ReleaseExtentImp(page_id_t first, int size) override;
+
+  /**
+   * @brief Create a partition, or update the quota of an existing one with the same name.
+   */
+  auto CreatePartitionImp(const std::string &name, size_t min_frames, size_t max_frames) -> partition_id_t override;
+
+  /** Number of pages WarmUp() reads between two acquisitions of the latch. */
+  static constexpr size_t WARM_UP_BATCH_SIZE = 64;
+  /** Identifies a hot-page file written by SaveHotPages(). */
+  static constexpr uint32_t HOT_PAGES_MAGIC = 0x48505742;
+
+  /** Number of pages a flush of many pages pins and writes at a time. */
+  static constexpr size_t FLUSH_BATCH_SIZE = 16;
+
+  /** Number of frames per chunk of the buffer pool. Must be a power of two. */
+  static constexpr size_t FRAME_CHUNK_SIZE = 64;
+  static_assert(FRAME_CHUNK_SIZE <= 64, "the dirty bitmap of a chunk is a single 64-bit word");
+
+  /**
+   * A fixed-size group of frames: their data, their Page objects and their dirty bitmap. The pool grows and
+   * shrinks by chunks.
+   */
+  struct FrameChunk {
+    /** Data of the frames, contiguous and page-aligned, so that it can be read and written with O_DIRECT. */
+    alignas(BUSTUB_PAGE_SIZE) char data_[FRAME_CHUNK_SIZE * BUSTUB_PAGE_SIZE];
+    /** Metadata of the frames, kept apart from the data, one cache-line aligned descriptor per frame. */
+    Page pages_[FRAME_CHUNK_SIZE];
+    /** Bit i is set while pages_[i] is dirty, maintained by Page::SetDirty(). */
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dirty_{0};
+  };
+
+  /** A page-aligned copy of a page, see WritePageSnapshot(). */
+  struct alignas(BUSTUB_PAGE_SIZE) StagingBuffer {
+    char data_[BUSTUB_PAGE_SIZE];
+  };
+
+  /** A named share of the frames with its quota, see BufferPoolManager::CreatePartition(). */
+  struct Partition {
+    std::string name_;
+    size_t min_frames_;
+    size_t max_frames_;
+    /** Number of frames holding a page of this partition. */
+    size_t frames_{0};
+  };
+
+  /** Number of pages in the buffer pool. Only changed by Resize() with the latch held. */
+  std::atomic<size_t> pool_size_;
+  /** The next page id to be allocated  */
+  std::atomic<page_id_t> next_page_id_ = 0;
+  /** Bucket size for the extendible hash table */
+  const size_t bucket_size_ = 4;
+
+  /** Chunks holding the frames; frame i is page i % FRAME_CHUNK_SIZE of chunk i / FRAME_CHUNK_SIZE. */
+  std::vector<std::unique_ptr<FrameChunk>> chunks_;
+  /** Pointer to the disk manager. */
+  DiskManager *disk_manager_ __attribute__((__unused__));
+  /** Pointer to the log manager. Please ignore this for P1. */
+  LogManager *log_manager_ __attribute__((__unused__));
+  /** Page table for keeping track of buffer pool pages. */
+  ExtendibleHashTable<page_id_t, frame_id_t> *page_table_;
+  /** Replacer to find unpinned pages for replacement. */
+  LRUKReplacer *replacer_;
+  /** The k of replacer_, the most history entries it keeps per frame. */
+  size_t replacer_k_;
+  /** List of free frames that don't have any pages on them. */
+  std::list<frame_id_t> free_list_;
+  /** Page ids below next_page_id_ that were deallocated and can be handed out again, ordered for nearest lookup. */
+  std::set<page_id_t> free_pages_;
+  /** Page ids reserved by ReserveExtent() that have not been created yet. */
+  std::set<page_id_t> reserved_pages_;
+  /** Pages WarmUp() is reading without the latch. A fetch from disk or an allocation of one of them removes it,
+   * and WarmUp() then drops its copy. */
+  std::unordered_set<page_id_t> warming_pages_;
+  /** Partitions indexed by partition id; partition DEFAULT_PARTITION_ID has no quota. */
+  std::vector<Partition> partitions_;
+  /** Partition each frame is charged to, meaningful while the frame holds a page. */
+  std::vector<partition_id_t> frame_partition_;
+  /** Pre-evict when the free list gets shorter than this, see SetFreeFrameWatermark(). */
+  size_t low_watermark_{0};
+  /** Number of pages pre-evicted at a time. */
+  size_t eviction_batch_size_{0};
+  /** Chunk where the next FlushSome() starts looking for dirty pages. */
+  size_t flush_cursor_{0};
+  /** Protects the frames' metadata, chunks_, page_table_, free_list_, free_pages_, reserved_pages_,
+   * warming_pages_ and the partitions. */
+  ProfiledMutex latch_{"bpm"};
+  /** Page-sized buffers that flushes copy pages into, reused across flushes. */
+  std::vector<std::unique_ptr<StagingBuffer>> staging_buffers_;
+  /** Protects staging_buffers_. */
+  ProfiledMutex staging_latch_{"bpm.staging"};
+
+  /**
+   * @brief Allocate a page on disk. Caller should acquire the latch before calling this function.
+   * @param hint a reserved page id to hand out as is, otherwise reuse the free page closest to this page id;
+   * INVALID_PAGE_ID reuses the lowest free page
+   * @return the id of the allocated page
+   */
+  auto AllocatePage(page_id_t hint = INVALID_PAGE_ID) -> page_id_t;
+
+  /**
+   * @brief Allocate size contiguous page ids, from a run of free pages if there is one, or from the end of the file
+   * otherwise. Caller should acquire the latch before calling this function.
+   * @return the first page id of the run
+   */
+  auto AllocateRun(int size) -> page_id_t;
+
+  /**
+   * @brief Deallocate a page on disk. Caller should acquire the latch before calling this function.
+   * @param page_id id of the page to deallocate
+   */
+  void DeallocatePage(page_id_t page_id);
+
+  /** @brief Return the Page object of a frame. Caller should acquire the latch before calling this function. */
+  auto GetFrame(frame_id_t frame_id) -> Page & {
+    return chunks_[frame_id / FRAME_CHUNK_SIZE]->pages_[frame_id % FRAME_CHUNK_SIZE];
+  }
+
+  /**
+   * @brief Take a frame for a page of partition, from the free list or by evicting a page (which is written back
+   * if dirty and removed from the page table), and charge it to partition. Caller should acquire the latch.
+   * @param[out] victim_page_id the page evicted for the frame, INVALID_PAGE_ID if it came from the free list
+   * @param[out] victim_dirty whether the evicted page was written back
+   * @return false if all frames that may be used are pinned
+   */
+  auto AcquireFrame(partition_id_t partition, frame_id_t *frame_id, page_id_t *victim_page_id, bool *victim_dirty)
+      -> bool;
+
+  /**
+   * @brief Pick a victim for partition according to the quotas: a partition at its cap evicts its own pages,
+   * otherwise pages of partitions over their cap go first, then pages of partitions over their guaranteed
+   * minimum or of partition itself. Caller should acquire the latch.
+   */
+  auto EvictFor(partition_id_t partition, frame_id_t *frame_id) -> bool;
+
+  /**
+   * @brief Return up to max_pages frames holding a dirty page, walking the dirty bitmaps from flush_cursor_ on.
+   * Caller should acquire the latch.
+   */
+  auto CollectDirtyFrames(size_t max_pages) -> std::vector<frame_id_t>;
+
+  /**
+   * @brief Write back the pages of frames that are still dirty, FLUSH_BATCH_SIZE at a time: pin them under the
+   * latch, then write them without it. Caller should not hold the latch.
+   * @return the number of pages written
+   */
+  auto FlushFrames(const std::vector<frame_id_t> &frames) -> size_t;
+
+  /**
+   * @brief Copy a pinned page into a staging buffer under its read latch, clear its dirty flag and write the copy
+   * to disk. Caller should not hold the latch.
+   */
+  void WritePageSnapshot(Page *page);
+
+  /** @brief Add a pin to a frame holding a page, making it non-evictable. Caller should acquire the latch. */
+  void PinFrame(frame_id_t frame_id);
+
+  /** @brief Drop a pin taken by PinFrame(). Caller should acquire the latch. */
+  void UnpinFrame(frame_id_t frame_id);
+
+  /**
+   * @brief Evict up to eviction_batch_size_ clean pages in one replacer pass and put their frames on the free list.
+   * Caller should acquire the latch.
+   */
+  void RefillFreeList();
+
+  /** @brief Allocate chunks until there are at least pool_size frames. */
+  void AddChunks(size_t pool_size);
+};
+}  // namespace bustub
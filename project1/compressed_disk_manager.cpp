@@ -0,0 +1,424 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// compressed_disk_manager.cpp
+//
+// Identification: src/storage/disk/compressed_disk_manager.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_disk_manager.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/macros.h"
+#include "storage/disk/page_codec.h"
+
+namespace bustub {
+
+static constexpr uint64_t PAGE_MAP_MAGIC = 0x3150414d47504342;  // "BCPGMAP1"
+/** page_id, length, capacity, raw, offset, then the CRC-32 of those 24 bytes. */
+static constexpr size_t MAP_LOG_RECORD_SIZE = 28;
+
+namespace {
+
+auto WriteFully(int fd, const char *data, size_t len, uint64_t offset) -> bool {
+  size_t written = 0;
+  while (written < len) {
+    ssize_t n = pwrite(fd, data + written, len - written, static_cast<off_t>(offset + written));
+    if (n <= 0) {
+      return false;
+    }
+    written += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+auto ReadFully(int fd, char *data, size_t len, uint64_t offset) -> bool {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pread(fd, data + done, len - done, static_cast<off_t>(offset + done));
+    if (n <= 0) {
+      return false;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+/** Make a rename inside the directory of file_name durable. */
+auto SyncDirectoryOf(const std::string &file_name) -> bool {
+  size_t slash = file_name.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : file_name.substr(0, slash == 0 ? 1 : slash);
+  int fd = open(dir.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+}  // namespace
+
+CompressedDiskManager::CompressedDiskManager(const std::string &db_file)
+    : data_file_name_(db_file), map_file_name_(db_file + ".pagemap"), log_file_name_(db_file + ".pagemap.log") {
+  // 文件不存在时先创建
+  data_fd_ = open(data_file_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (data_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
+  LoadPageMap();
+  // 把上次运行留下的日志并进检查点，顺便截掉写了一半的日志尾部
+  if (!Checkpoint()) {
+    throw Exception("can't write page map file " + map_file_name_);
+  }
+}
+
+CompressedDiskManager::~CompressedDiskManager() { ShutDown(); }
+
+void CompressedDiskManager::ShutDown() {
+  std::scoped_lock<std::mutex> sync_lock(sync_latch_);
+  if (shut_down_) {
+    return;
+  }
+  // 先把排队的映射写进日志，这样检查点写失败也不要紧：下次打开时会重放
+  try {
+    SyncMapLog();
+  } catch (const Exception &e) {
+    LOG_DEBUG("%s", e.what());
+  }
+  reuse_latch_.WLock();
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    if (!Checkpoint()) {
+      LOG_DEBUG("I/O error while writing page map");
+    }
+    close(data_fd_);
+    close(log_fd_);
+    shut_down_ = true;
+  }
+  reuse_latch_.WUnlock();
+}
+
+void CompressedDiskManager::Sync() {
+  std::scoped_lock<std::mutex> sync_lock(sync_latch_);
+  SyncMapLog();
+}
+
+void CompressedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  BUSTUB_ASSERT(page_id >= 0, "Invalid page id");
+
+  // 压缩在锁外进行，只有文件和映射表的更新需要持锁
+  auto start = std::chrono::steady_clock::now();
+  std::string compressed;
+  compressed.reserve(BUSTUB_PAGE_SIZE);
+  PageCodec::Compress(page_data, BUSTUB_PAGE_SIZE, &compressed);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  compress_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+  // 压缩后反而更大的页按原样存储
+  bool raw = compressed.size() >= static_cast<size_t>(BUSTUB_PAGE_SIZE);
+  const char *payload = raw ? page_data : compressed.data();
+  auto length = static_cast<uint32_t>(raw ? BUSTUB_PAGE_SIZE : compressed.size());
+
+  // 1. 总是写到另一个 extent，崩溃时旧的映像和指向它的映射都还完整；新 extent 只属于本次写，写数据时不持锁
+  Extent extent;
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    extent = AllocateExtent(length);
+  }
+  extent.length_ = length;
+  extent.raw_ = raw;
+  if (!WriteFully(data_fd_, payload, length, extent.offset_)) {
+    // 映射还没有记录，这个 extent 可以直接复用
+    std::scoped_lock<std::mutex> lock(latch_);
+    FreeExtent(extent);
+    throw Exception("I/O error while writing page " + std::to_string(page_id));
+  }
+
+  // 2. 数据写完之后才排队新的映射：同步时先同步数据文件，再写日志
+  bool group_full;
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    if (static_cast<size_t>(page_id) >= page_map_.size()) {
+      page_map_.resize(page_id + 1);
+    }
+    Extent old = page_map_[page_id];
+    page_map_[page_id] = extent;
+    AppendMapLog(page_id, extent);
+    // 旧 extent 在日志记录落盘之前仍被持久化的映射引用，不能复用
+    if (old.capacity_ != 0) {
+      pending_free_.push_back(old);
+    }
+    group_full = pending_log_.size() >= MAP_LOG_GROUP_SIZE * MAP_LOG_RECORD_SIZE;
+  }
+
+  pages_written_++;
+  logical_bytes_written_ += BUSTUB_PAGE_SIZE;
+  physical_bytes_written_ += length;
+
+  // 3. 凑满一组时由这次写同步整组；已有线程在同步时不必等它，那次同步之后的记录留给下一组
+  if (group_full) {
+    std::unique_lock<std::mutex> sync_lock(sync_latch_, std::try_to_lock);
+    if (sync_lock.owns_lock()) {
+      SyncMapLog();
+    }
+  }
+}
+
+void CompressedDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  BUSTUB_ASSERT(page_id >= 0, "Invalid page id");
+
+  std::string compressed;
+  Extent extent;
+  // 读锁保证读取期间这个 extent 不会被释放后分给别的页；读文件时不持有 latch_
+  reuse_latch_.RLock();
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    if (static_cast<size_t>(page_id) < page_map_.size()) {
+      extent = page_map_[page_id];
+    }
+  }
+  if (extent.length_ == 0) {
+    reuse_latch_.RUnlock();
+    // 与 DiskManager 一致：读取从未写过的页得到全零
+    memset(page_data, 0, BUSTUB_PAGE_SIZE);
+    return;
+  }
+  char *dst = page_data;
+  if (!extent.raw_) {
+    compressed.resize(extent.length_);
+    dst = compressed.data();
+  }
+  bool read_ok = ReadFully(data_fd_, dst, extent.length_, extent.offset_);
+  reuse_latch_.RUnlock();
+  if (!read_ok) {
+    throw Exception("I/O error while reading page " + std::to_string(page_id));
+  }
+
+  pages_read_++;
+  physical_bytes_read_ += extent.length_;
+  if (extent.raw_) {
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  bool ok = PageCodec::Decompress(compressed.data(), compressed.size(), page_data, BUSTUB_PAGE_SIZE);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  decompress_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  if (!ok) {
+    throw Exception("corrupted compressed page " + std::to_string(page_id));
+  }
+}
+
+auto CompressedDiskManager::GetStats() const -> Stats {
+  return {pages_written_.load(),          pages_read_.load(),          logical_bytes_written_.load(),
+          physical_bytes_written_.load(), physical_bytes_read_.load(), compress_ns_.load(),
+          decompress_ns_.load()};
+}
+
+auto CompressedDiskManager::AllocateExtent(uint32_t length) -> Extent {
+  uint32_t capacity = (length + EXTENT_ALIGNMENT - 1) / EXTENT_ALIGNMENT * EXTENT_ALIGNMENT;
+  Extent extent;
+  extent.capacity_ = capacity;
+
+  // best fit：取容量足够的最小空闲 extent
+  auto it = free_extents_.lower_bound(capacity);
+  if (it != free_extents_.end()) {
+    extent.offset_ = it->second;
+    extent.capacity_ = it->first;
+    free_extents_.erase(it);
+    return extent;
+  }
+
+  extent.offset_ = end_offset_;
+  end_offset_ += capacity;
+  return extent;
+}
+
+void CompressedDiskManager::FreeExtent(const Extent &extent) {
+  free_extents_.emplace(extent.capacity_, extent.offset_);
+}
+
+void CompressedDiskManager::LoadPageMap() {
+  // 没有检查点时可能仍有日志：上一次运行在第一次检查点之前就崩溃了
+  std::ifstream in(map_file_name_, std::ios::binary);
+  if (in.is_open()) {
+    uint64_t magic = 0;
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!in || magic != PAGE_MAP_MAGIC) {
+      throw Exception("invalid page map file " + map_file_name_);
+    }
+
+    page_map_.resize(count);
+    for (auto &extent : page_map_) {
+      in.read(reinterpret_cast<char *>(&extent.offset_), sizeof(extent.offset_));
+      in.read(reinterpret_cast<char *>(&extent.length_), sizeof(extent.length_));
+      in.read(reinterpret_cast<char *>(&extent.capacity_), sizeof(extent.capacity_));
+      in.read(reinterpret_cast<char *>(&extent.raw_), sizeof(extent.raw_));
+    }
+    if (!in) {
+      throw Exception("truncated page map file " + map_file_name_);
+    }
+  }
+  ReplayMapLog();
+
+  // 根据已使用的 extent 重建空闲空间：两个相邻 extent 之间的空隙都可以复用
+  std::vector<Extent> used;
+  for (const auto &extent : page_map_) {
+    if (extent.capacity_ != 0) {
+      used.push_back(extent);
+    }
+  }
+  std::sort(used.begin(), used.end(), [](const Extent &a, const Extent &b) { return a.offset_ < b.offset_; });
+  for (const auto &extent : used) {
+    if (extent.offset_ > end_offset_) {
+      free_extents_.emplace(static_cast<uint32_t>(extent.offset_ - end_offset_), end_offset_);
+    }
+    end_offset_ = std::max(end_offset_, extent.offset_ + extent.capacity_);
+  }
+}
+
+void CompressedDiskManager::ReplayMapLog() {
+  std::ifstream in(log_file_name_, std::ios::binary);
+  char record[MAP_LOG_RECORD_SIZE];
+  // 崩溃时最后一条记录可能只写了一半，校验不过就停下
+  while (in.read(record, MAP_LOG_RECORD_SIZE)) {
+    uint32_t crc;
+    memcpy(&crc, record + 24, sizeof(crc));
+    if (crc != PageCodec::Crc32(record, 24)) {
+      break;
+    }
+    page_id_t page_id;
+    uint32_t raw;
+    Extent extent;
+    memcpy(&page_id, record, sizeof(page_id));
+    memcpy(&extent.length_, record + 4, sizeof(extent.length_));
+    memcpy(&extent.capacity_, record + 8, sizeof(extent.capacity_));
+    memcpy(&raw, record + 12, sizeof(raw));
+    memcpy(&extent.offset_, record + 16, sizeof(extent.offset_));
+    extent.raw_ = raw != 0;
+    if (page_id < 0) {
+      break;
+    }
+    if (static_cast<size_t>(page_id) >= page_map_.size()) {
+      page_map_.resize(page_id + 1);
+    }
+    page_map_[page_id] = extent;
+  }
+}
+
+void CompressedDiskManager::AppendMapLog(page_id_t page_id, const Extent &extent) {
+  char record[MAP_LOG_RECORD_SIZE];
+  auto raw = static_cast<uint32_t>(extent.raw_);
+  memcpy(record, &page_id, sizeof(page_id));
+  memcpy(record + 4, &extent.length_, sizeof(extent.length_));
+  memcpy(record + 8, &extent.capacity_, sizeof(extent.capacity_));
+  memcpy(record + 12, &raw, sizeof(raw));
+  memcpy(record + 16, &extent.offset_, sizeof(extent.offset_));
+  uint32_t crc = PageCodec::Crc32(record, 24);
+  memcpy(record + 24, &crc, sizeof(crc));
+  pending_log_.append(record, MAP_LOG_RECORD_SIZE);
+}
+
+void CompressedDiskManager::SyncMapLog() {
+  std::string records;
+  std::vector<Extent> freed;
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    records.swap(pending_log_);
+    freed.swap(pending_free_);
+  }
+  if (records.empty()) {
+    return;
+  }
+
+  // 这些记录指向的数据在排队之前都已写完，先让它们落盘，再让指向它们的记录落盘
+  if (fdatasync(data_fd_) != 0 || !WriteFully(log_fd_, records.data(), records.size(), log_size_) ||
+      fdatasync(log_fd_) != 0) {
+    // 截掉可能写了一半的记录，免得后面的记录接在它后面、重放时被一起丢掉；记录放回队列，下次同步重试
+    if (ftruncate(log_fd_, static_cast<off_t>(log_size_)) != 0) {
+      LOG_DEBUG("I/O error while truncating page map log");
+    }
+    std::scoped_lock<std::mutex> lock(latch_);
+    pending_log_.insert(0, records);
+    pending_free_.insert(pending_free_.end(), freed.begin(), freed.end());
+    throw Exception("I/O error while writing page map log " + log_file_name_);
+  }
+  log_size_ += records.size();
+
+  // 新映射已经持久化，旧 extent 不再被引用；等正在读它们的 ReadPage 结束后才可以复用
+  reuse_latch_.WLock();
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    for (const auto &extent : freed) {
+      FreeExtent(extent);
+    }
+  }
+  reuse_latch_.WUnlock();
+}
+
+auto CompressedDiskManager::Checkpoint() -> bool {
+  // page_map_ 可能指向还没有同步的数据
+  if (fdatasync(data_fd_) != 0) {
+    return false;
+  }
+  std::string image;
+  uint64_t count = page_map_.size();
+  image.append(reinterpret_cast<const char *>(&PAGE_MAP_MAGIC), sizeof(PAGE_MAP_MAGIC));
+  image.append(reinterpret_cast<const char *>(&count), sizeof(count));
+  for (const auto &extent : page_map_) {
+    image.append(reinterpret_cast<const char *>(&extent.offset_), sizeof(extent.offset_));
+    image.append(reinterpret_cast<const char *>(&extent.length_), sizeof(extent.length_));
+    image.append(reinterpret_cast<const char *>(&extent.capacity_), sizeof(extent.capacity_));
+    image.append(reinterpret_cast<const char *>(&extent.raw_), sizeof(extent.raw_));
+  }
+
+  // 先写临时文件再 rename，崩溃时要么是旧检查点加日志，要么是新检查点
+  std::string tmp_file_name = map_file_name_ + ".tmp";
+  int fd = open(tmp_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = WriteFully(fd, image.data(), image.size(), 0) && fsync(fd) == 0;
+  close(fd);
+  if (!ok || rename(tmp_file_name.c_str(), map_file_name_.c_str()) != 0 || !SyncDirectoryOf(map_file_name_)) {
+    return false;
+  }
+
+  // 新检查点已经持久化，日志里的记录都包含在里面了
+  if (log_fd_ < 0) {
+    log_fd_ = open(log_file_name_.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (log_fd_ < 0) {
+      return false;
+    }
+  }
+  if (ftruncate(log_fd_, 0) != 0 || fsync(log_fd_) != 0) {
+    return false;
+  }
+  log_size_ = 0;
+  // 排队的记录都已包含在检查点里，它们让出的 extent 可以复用了
+  pending_log_.clear();
+  for (const auto &extent : pending_free_) {
+    FreeExtent(extent);
+  }
+  pending_free_.clear();
+  return true;
+}
+
+}  // namespace bustub
@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// compressed_disk_manager.h
+//
+// Identification: src/include/storage/disk/compressed_disk_manager.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rwlatch.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * CompressedDiskManager stores pages compressed on disk while the buffer pool
+ * keeps working with uncompressed BUSTUB_PAGE_SIZE frames.
+ *
+ * Pages are encoded with PageCodec on WritePage and decoded on ReadPage. Since
+ * compressed pages have variable sizes, a page map translates page_id into an
+ * extent (offset, length) of the data file. A rewritten page always moves to a
+ * recycled or new extent, so a crash in the middle of a write leaves the old
+ * image intact.
+ *
+ * The page map is checkpointed to "<db_file>.pagemap" on open, by ShutDown()
+ * and on destruction. In between, WritePage writes the page to a new extent
+ * and queues the new mapping. Every MAP_LOG_GROUP_SIZE mappings, and on
+ * Sync(), the data file is synced and the queued mappings are appended to
+ * "<db_file>.pagemap.log" and synced, so the checkpoint plus the log always
+ * describe data on disk. The old extent of a page is only reused after the
+ * log record that moved the page away from it is synced. After a crash, pages
+ * whose mappings were still queued read back their previous image.
+ *
+ * Reads and writes of page data and the syncs run outside the latch that
+ * protects the page map; only the write that completes a group waits for the
+ * syncs, once per MAP_LOG_GROUP_SIZE writes.
+ *
+ * Usage: pass it to BufferPoolManagerInstance in place of a DiskManager.
+ */
+class CompressedDiskManager : public DiskManager {
+ public:
+  /** Compression statistics; byte counts are for WritePage/ReadPage calls so far. */
+  struct Stats {
+    uint64_t pages_written_;
+    uint64_t pages_read_;
+    uint64_t logical_bytes_written_;
+    uint64_t physical_bytes_written_;
+    uint64_t physical_bytes_read_;
+    uint64_t compress_ns_;
+    uint64_t decompress_ns_;
+
+    /** @return logical / physical bytes written, 1.0 if nothing was written yet */
+    auto CompressionRatio() const -> double {
+      return physical_bytes_written_ == 0 ? 1.0
+                                          : static_cast<double>(logical_bytes_written_) / physical_bytes_written_;
+    }
+  };
+
+  /**
+   * @brief Open (or create) a compressed database file.
+   * @param db_file the file name of the database file
+   */
+  explicit CompressedDiskManager(const std::string &db_file);
+
+  ~CompressedDiskManager() override;
+
+  /**
+   * @brief Persist the page map and close the data file.
+   */
+  void ShutDown();
+
+  /**
+   * @brief Compress and write a page to the database file.
+   * @throws Exception if the data can't be written, and the page keeps its old image; or if syncing a completed
+   * group of mappings fails, and the new image is read back but may not survive a crash
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * @brief Make the pages written so far durable: sync the data file and the queued mappings.
+   * @throws Exception on I/O errors; the mappings stay queued and are retried by the next sync
+   */
+  void Sync();
+
+  /**
+   * @brief Read a page from the database file and decompress it into page_data.
+   * Pages that were never written read back as zeros.
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** @return a snapshot of the compression statistics */
+  auto GetStats() const -> Stats;
+
+ private:
+  /** Location of one compressed page in the data file. length_ == 0 means not written yet. */
+  struct Extent {
+    uint64_t offset_{0};
+    uint32_t length_{0};
+    uint32_t capacity_{0};
+    /** true if the page did not compress and is stored as-is */
+    bool raw_{false};
+  };
+
+  /** Extents are allocated in multiples of this many bytes, so small growth can be absorbed in place. */
+  static constexpr uint32_t EXTENT_ALIGNMENT = 64;
+  /** Mappings WritePage queues before the write that completes the group syncs them. */
+  static constexpr size_t MAP_LOG_GROUP_SIZE = 64;
+
+  auto AllocateExtent(uint32_t length) -> Extent;
+  void FreeExtent(const Extent &extent);
+  void LoadPageMap();
+  /** Apply the records of the map log that were completely written. */
+  void ReplayMapLog();
+  /** Queue the record page_id -> extent for the map log; needs latch_. */
+  void AppendMapLog(page_id_t page_id, const Extent &extent);
+  /** Sync the data file, then append the queued records to the map log and sync it; needs sync_latch_. */
+  void SyncMapLog();
+  /**
+   * Sync the data file, atomically replace the page map file with page_map_ and empty the map log; needs
+   * sync_latch_, reuse_latch_ in write mode and latch_, unless no other call can run.
+   * @return false on I/O errors
+   */
+  auto Checkpoint() -> bool;
+
+  std::string data_file_name_;
+  std::string map_file_name_;
+  std::string log_file_name_;
+  int data_fd_{-1};
+  int log_fd_{-1};
+  /** Bytes of complete records in the map log; protected by sync_latch_. */
+  uint64_t log_size_{0};
+  /** Records for the map log that are not synced yet. */
+  std::string pending_log_;
+  /** Extents the pages of pending_log_ moved away from; reused once the records are synced. */
+  std::vector<Extent> pending_free_;
+
+  /** page_id -> extent */
+  std::vector<Extent> page_map_;
+  /** Unused extents keyed by capacity, for best-fit reuse. */
+  std::multimap<uint32_t, uint64_t> free_extents_;
+  /** End of the data file. */
+  uint64_t end_offset_{0};
+  bool shut_down_{false};
+
+  std::atomic<uint64_t> pages_written_{0};
+  std::atomic<uint64_t> pages_read_{0};
+  std::atomic<uint64_t> logical_bytes_written_{0};
+  std::atomic<uint64_t> physical_bytes_written_{0};
+  std::atomic<uint64_t> physical_bytes_read_{0};
+  std::atomic<uint64_t> compress_ns_{0};
+  std::atomic<uint64_t> decompress_ns_{0};
+
+  /** Serializes syncs and checkpoints. Taken before reuse_latch_ and latch_. */
+  std::mutex sync_latch_;
+  /** Held in read mode while a page is read, in write mode while freed extents become reusable. */
+  ReaderWriterLatch reuse_latch_{"extent_reuse"};
+  /** Protects page_map_, free_extents_, end_offset_, pending_log_ and pending_free_; never held during I/O. */
+  std::mutex latch_;
+};
+
+}  // namespace bustub
@@ -16,6 +16,7 @@
 #include <list>
 #include <utility>
 
+#include "common/metrics.h"
 #include "container/hash/extendible_hash_table.h"
 #include "storage/page/page.h"
 
@@ -68,6 +69,7 @@ auto ExtendibleHashTable<K, V>::GetNumBucketsInternal() const -> int {
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Find(const K &key, V &value) -> bool {
+  BUSTUB_METRIC_COUNT("hash.find", 1);
   std::scoped_lock<std::mutex> lock(latch_);
   size_t index = IndexOf(key);
   return dir_[index]->Find(key, value);
@@ -75,6 +77,7 @@ auto ExtendibleHashTable<K, V>::Find(const K &key, V &value) -> bool {
 
 template <typename K, typename V>
 auto ExtendibleHashTable<K, V>::Remove(const K &key) -> bool {
+  BUSTUB_METRIC_COUNT("hash.remove", 1);
   std::scoped_lock<std::mutex> lock(latch_);
   size_t index = IndexOf(key);
   return dir_[index]->Remove(key);
@@ -82,6 +85,7 @@ auto ExtendibleHashTable<K, V>::Remove(const K &key) -> bool {
 
 template <typename K, typename V>
 void ExtendibleHashTable<K, V>::Insert(const K &key, const V &value) {
+  BUSTUB_METRIC_COUNT("hash.insert", 1);
   std::scoped_lock<std::mutex> lock(latch_);
   
   while (true) {
@@ -99,6 +103,7 @@ void ExtendibleHashTable<K, V>::Insert(const K &key, const V &value) {
     
     // 如果局部深度等于全局深度，需要先增加全局深度
     if (local_depth == global_depth) {
+      BUSTUB_METRIC_COUNT("hash.grow", 1);
       global_depth_++;
       size_t dir_size = dir_.size();
       // 扩展目录，每个现有条目都复制一份
@@ -113,6 +118,7 @@ void ExtendibleHashTable<K, V>::Insert(const K &key, const V &value) {
     
     auto new_bucket = std::make_shared<Bucket>(bucket_size_, local_depth);
     num_buckets_++;
+    BUSTUB_METRIC_COUNT("hash.split", 1);
     
     // 重新分配桶中的元素
     auto &items = target_bucket->GetItems();
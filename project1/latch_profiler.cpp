@@ -0,0 +1,295 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// latch_profiler.cpp
+//
+// Identification: src/common/latch_profiler.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/latch_profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+namespace bustub {
+
+/** 一个线程的统计表，只由该线程写入，报告时由其他线程读取 */
+struct LatchProfiler::ThreadTable {
+  struct Slot {
+    /** 最后写入并以 release 发布，读到非空时其余键字段已可见 */
+    std::atomic<const char *> latch_{nullptr};
+    LatchMode mode_{LatchMode::SHARED};
+    const char *site_{nullptr};
+    int line_{0};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> contended_{0};
+    std::atomic<uint64_t> wait_ns_{0};
+    std::atomic<uint64_t> max_wait_ns_{0};
+  };
+
+  /** @return 键对应的槽，没有则占用一个空槽；表满时返回 nullptr */
+  auto Find(const char *latch, LatchMode mode, const char *site, int line) -> Slot * {
+    size_t hash = reinterpret_cast<uintptr_t>(latch) * 0x9E3779B97F4A7C15ULL;
+    hash ^= reinterpret_cast<uintptr_t>(site) * 0xC2B2AE3D27D4EB4FULL;
+    hash ^= static_cast<size_t>(line) * 31 + static_cast<size_t>(mode);
+    for (size_t i = 0; i < LATCH_PROFILER_SLOTS; i++) {
+      Slot &slot = slots_[(hash + i) % LATCH_PROFILER_SLOTS];
+      const char *slot_latch = slot.latch_.load(std::memory_order_relaxed);
+      if (slot_latch == nullptr) {
+        slot.mode_ = mode;
+        slot.site_ = site;
+        slot.line_ = line;
+        slot.latch_.store(latch, std::memory_order_release);
+        return &slot;
+      }
+      if (slot_latch == latch && slot.mode_ == mode && slot.site_ == site && slot.line_ == line) {
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  /** 只有本线程写，所以用 load + store 代替带 lock 前缀的原子加 */
+  static void Bump(std::atomic<uint64_t> *value, uint64_t n) {
+    value->store(value->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  void Add(const char *latch, LatchMode mode, const char *site, int line, bool contended, uint64_t wait_ns) {
+    Slot *slot = Find(latch, mode, site, line);
+    if (slot == nullptr) {
+      Bump(&dropped_, 1);
+      return;
+    }
+    Bump(&slot->count_, 1);
+    if (contended) {
+      Bump(&slot->contended_, 1);
+      Bump(&slot->wait_ns_, wait_ns);
+      if (wait_ns > slot->max_wait_ns_.load(std::memory_order_relaxed)) {
+        slot->max_wait_ns_.store(wait_ns, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** 把各槽累加到 merged 中；同名的字符串常量在不同编译单元中地址可能不同，所以按字符串合并 */
+  void MergeInto(std::map<SiteKey, LatchSiteStats> *merged) const {
+    for (const auto &slot : slots_) {
+      const char *latch = slot.latch_.load(std::memory_order_acquire);
+      if (latch == nullptr) {
+        continue;
+      }
+      std::string site = slot.site_;
+      if (slot.line_ != 0) {
+        site += ":" + std::to_string(slot.line_);
+      }
+      auto &stats = (*merged)[std::make_tuple(std::string(latch), slot.mode_, site)];
+      stats.latch_ = latch;
+      stats.mode_ = slot.mode_;
+      stats.site_ = site;
+      stats.count_ += slot.count_.load(std::memory_order_relaxed);
+      stats.contended_ += slot.contended_.load(std::memory_order_relaxed);
+      stats.wait_ns_ += slot.wait_ns_.load(std::memory_order_relaxed);
+      stats.max_wait_ns_ = std::max(stats.max_wait_ns_, slot.max_wait_ns_.load(std::memory_order_relaxed));
+    }
+  }
+
+  std::array<Slot, LATCH_PROFILER_SLOTS> slots_;
+  /** 表满后未能记录的次数 */
+  std::atomic<uint64_t> dropped_{0};
+};
+
+auto LatchProfiler::Instance() -> LatchProfiler & {
+  // 与 MetricsRegistry 相同，故意不析构
+  static auto *profiler = new LatchProfiler();
+  return *profiler;
+}
+
+auto LatchProfiler::WaitHistogram(const char *name) -> Histogram * {
+  std::scoped_lock<std::mutex> lock(latch_);
+  for (const auto &[histogram_name, histogram] : histograms_) {
+    if (histogram_name == name) {
+      return histogram;
+    }
+  }
+  Histogram *histogram = MetricsRegistry::Instance().GetHistogram(std::string("latch.") + name + ".wait_ns");
+  histograms_.emplace_back(name, histogram);
+  return histogram;
+}
+
+auto LatchProfiler::LocalTable() -> ThreadTable * {
+  thread_local ThreadTable *table = nullptr;
+  thread_local bool exiting = false;
+  // 线程退出时由 Retirer 的析构函数把表并入 retired_；之后（例如别的 thread_local 析构时）再拿锁不再记录
+  struct Retirer {
+    ~Retirer() {
+      if (table != nullptr) {
+        LatchProfiler::Instance().Retire(table);
+      }
+      table = nullptr;
+      exiting = true;
+    }
+  };
+  if (table == nullptr && !exiting) {
+    thread_local Retirer retirer;
+    auto owned = std::make_unique<ThreadTable>();
+    table = owned.get();
+    std::scoped_lock<std::mutex> lock(latch_);
+    tables_.push_back(std::move(owned));
+  }
+  return table;
+}
+
+void LatchProfiler::Retire(ThreadTable *table) {
+  std::scoped_lock<std::mutex> lock(latch_);
+  table->MergeInto(&retired_);
+  retired_dropped_ += table->dropped_.load(std::memory_order_relaxed);
+  tables_.erase(std::find_if(tables_.begin(), tables_.end(),
+                             [table](const std::unique_ptr<ThreadTable> &owned) { return owned.get() == table; }));
+}
+
+void LatchProfiler::Record(const char *latch, LatchMode mode, const char *site, int line, bool contended,
+                           uint64_t wait_ns, const char *holder, int holder_line) {
+  ThreadTable *table = LocalTable();
+  if (table == nullptr) {
+    return;
+  }
+  table->Add(latch, mode, site, line, contended, wait_ns);
+  if (contended) {
+    // 等待算在开始等待时的独占持有者头上；没有独占持有者说明是被读者挡住，或持有者恰好已释放
+    table->Add(latch, LatchMode::HOLDER, holder != nullptr ? holder : "(no writer)",
+               holder != nullptr ? holder_line : 0, true, wait_ns);
+  }
+}
+
+auto LatchProfiler::Snapshot() const -> std::vector<LatchSiteStats> {
+  std::scoped_lock<std::mutex> lock(latch_);
+  std::map<SiteKey, LatchSiteStats> merged = retired_;
+  for (const auto &table : tables_) {
+    table->MergeInto(&merged);
+  }
+  std::vector<LatchSiteStats> result;
+  result.reserve(merged.size());
+  for (auto &[key, stats] : merged) {
+    result.push_back(std::move(stats));
+  }
+  return result;
+}
+
+auto LatchProfiler::Report(size_t top) const -> std::string {
+  std::vector<LatchSiteStats> sites = Snapshot();
+
+  // 1. 按锁汇总，按总等待时间排序
+  std::map<std::string, LatchSiteStats> latches;
+  for (const auto &site : sites) {
+    if (site.mode_ == LatchMode::HOLDER) {
+      continue;
+    }
+    auto &total = latches[site.latch_];
+    total.latch_ = site.latch_;
+    total.count_ += site.count_;
+    total.contended_ += site.contended_;
+    total.wait_ns_ += site.wait_ns_;
+    total.max_wait_ns_ = std::max(total.max_wait_ns_, site.max_wait_ns_);
+  }
+  std::vector<LatchSiteStats> ranked;
+  for (auto &[name, total] : latches) {
+    ranked.push_back(total);
+  }
+  auto by_wait = [](const LatchSiteStats &a, const LatchSiteStats &b) { return a.wait_ns_ > b.wait_ns_; };
+  std::sort(ranked.begin(), ranked.end(), by_wait);
+
+  std::string out;
+  char line[512];
+  snprintf(line, sizeof(line), "%-16s %14s %12s %8s %12s %10s %10s %10s\n", "latch", "acquisitions", "contended",
+           "pct", "wait_ms", "p50_ns", "p99_ns", "max_ns");
+  out += line;
+  for (const auto &total : ranked) {
+    HistogramSnapshot wait;
+    {
+      std::scoped_lock<std::mutex> lock(latch_);
+      for (const auto &[name, histogram] : histograms_) {
+        if (name == total.latch_) {
+          wait = histogram->Snapshot();
+          break;
+        }
+      }
+    }
+    snprintf(line, sizeof(line), "%-16s %14llu %12llu %7.2f%% %12.3f %10llu %10llu %10llu\n", total.latch_.c_str(),
+             static_cast<unsigned long long>(total.count_),      // NOLINT
+             static_cast<unsigned long long>(total.contended_),  // NOLINT
+             total.count_ == 0 ? 0.0 : 100.0 * total.contended_ / total.count_, total.wait_ns_ / 1e6,
+             static_cast<unsigned long long>(wait.Percentile(0.5)),   // NOLINT
+             static_cast<unsigned long long>(wait.Percentile(0.99)),  // NOLINT
+             static_cast<unsigned long long>(total.max_wait_ns_));    // NOLINT
+    out += line;
+  }
+
+  // 2. 等待最久的获取位置，以及让别人等待最久的持有位置
+  std::vector<LatchSiteStats> waiters;
+  std::vector<LatchSiteStats> holders;
+  for (auto &site : sites) {
+    if (site.wait_ns_ == 0) {
+      continue;
+    }
+    (site.mode_ == LatchMode::HOLDER ? holders : waiters).push_back(std::move(site));
+  }
+  std::sort(waiters.begin(), waiters.end(), by_wait);
+  std::sort(holders.begin(), holders.end(), by_wait);
+
+  out += "\nsites that waited longest:\n";
+  for (size_t i = 0; i < waiters.size() && i < top; i++) {
+    const auto &site = waiters[i];
+    snprintf(line, sizeof(line), "  %-16s %s %-40s acquisitions=%llu contended=%llu wait_ms=%.3f max_ns=%llu\n",
+             site.latch_.c_str(), site.mode_ == LatchMode::SHARED ? "R" : "W", site.site_.c_str(),
+             static_cast<unsigned long long>(site.count_), static_cast<unsigned long long>(site.contended_),  // NOLINT
+             site.wait_ns_ / 1e6, static_cast<unsigned long long>(site.max_wait_ns_));                      // NOLINT
+    out += line;
+  }
+  out += "\nholders that made others wait longest:\n";
+  for (size_t i = 0; i < holders.size() && i < top; i++) {
+    const auto &site = holders[i];
+    snprintf(line, sizeof(line), "  %-16s %-42s waits=%llu wait_ms=%.3f max_ns=%llu\n", site.latch_.c_str(),
+             site.site_.c_str(), static_cast<unsigned long long>(site.count_), site.wait_ns_ / 1e6,  // NOLINT
+             static_cast<unsigned long long>(site.max_wait_ns_));                                   // NOLINT
+    out += line;
+  }
+
+  uint64_t dropped = 0;
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    dropped = retired_dropped_;
+    for (const auto &table : tables_) {
+      dropped += table->dropped_.load(std::memory_order_relaxed);
+    }
+  }
+  if (dropped > 0) {
+    snprintf(line, sizeof(line), "\n%llu acquisitions not recorded, per-thread tables full\n",
+             static_cast<unsigned long long>(dropped));  // NOLINT
+    out += line;
+  }
+  return out;
+}
+
+void LatchProfiler::Reset() {
+  std::scoped_lock<std::mutex> lock(latch_);
+  for (auto &table : tables_) {
+    for (auto &slot : table->slots_) {
+      slot.count_.store(0, std::memory_order_relaxed);
+      slot.contended_.store(0, std::memory_order_relaxed);
+      slot.wait_ns_.store(0, std::memory_order_relaxed);
+      slot.max_wait_ns_.store(0, std::memory_order_relaxed);
+    }
+    table->dropped_.store(0, std::memory_order_relaxed);
+  }
+  retired_.clear();
+  retired_dropped_ = 0;
+  for (auto &[name, histogram] : histograms_) {
+    histogram->Reset();
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,120 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// latch_profiler.h
+//
+// Identification: src/include/common/latch_profiler.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "common/metrics.h"
+
+/**
+ * Build with -DBUSTUB_LATCH_PROFILE=1 to make ReaderWriterLatch and
+ * ProfiledMutex report every acquisition to the LatchProfiler. Off by default:
+ * page latches are taken on every tree hop, and even a per-thread counter
+ * update is noticeable there.
+ */
+#ifndef BUSTUB_LATCH_PROFILE
+#define BUSTUB_LATCH_PROFILE 0
+#endif
+
+namespace bustub {
+
+/** Per-thread slots for (latch, mode, call site) combinations; more are counted as dropped. */
+static constexpr size_t LATCH_PROFILER_SLOTS = 512;
+
+enum class LatchMode : uint8_t {
+  SHARED,
+  EXCLUSIVE,
+  /** Not an acquisition: the site held the latch exclusively while another thread waited for it. */
+  HOLDER,
+};
+
+/** Merged statistics of one call site of one kind of latch. */
+struct LatchSiteStats {
+  std::string latch_;
+  LatchMode mode_;
+  /** Function:line of the call site; as a HOLDER "(no writer)" if no writer held the latch at the wait. */
+  std::string site_;
+  /** Acquisitions, or for HOLDER the number of waits it caused. */
+  uint64_t count_{0};
+  /** Acquisitions that had to wait. */
+  uint64_t contended_{0};
+  /** Total and longest wait, or for HOLDER the waits it caused. */
+  uint64_t wait_ns_{0};
+  uint64_t max_wait_ns_{0};
+};
+
+/**
+ * Collects latch acquisitions by latch name and call site. Each thread counts
+ * into its own table, so profiling does not add contention of its own; the
+ * tables are merged when a report is made. A thread's table is folded into a
+ * shared one and freed when the thread exits, so short-lived threads do not
+ * add up. Uncontended acquisitions only cost
+ * a try-lock and a table update, contended ones are timed and their wait is
+ * recorded into the histogram "latch.<name>.wait_ns" of the MetricsRegistry.
+ */
+class LatchProfiler {
+ public:
+  static auto Instance() -> LatchProfiler &;
+
+  /** @return the histogram of contended waits for latches called name */
+  auto WaitHistogram(const char *name) -> Histogram *;
+
+  /**
+   * Count one acquisition by the calling thread.
+   * @param holder the site holding the latch exclusively when the wait began, nullptr if it was held shared
+   */
+  void Record(const char *latch, LatchMode mode, const char *site, int line, bool contended, uint64_t wait_ns,
+              const char *holder, int holder_line);
+
+  /** @return the statistics of all threads, merged by latch name, mode and site */
+  auto Snapshot() const -> std::vector<LatchSiteStats>;
+
+  /**
+   * @return a report of the latches ranked by total wait, each with its wait
+   * percentiles, and the top sites that waited and that made others wait
+   */
+  auto Report(size_t top = 10) const -> std::string;
+
+  /** Zero all statistics. Acquisitions that race with it may be lost. */
+  void Reset();
+
+ private:
+  struct ThreadTable;
+  /** Latch name, mode and "function:line" of a call site. */
+  using SiteKey = std::tuple<std::string, LatchMode, std::string>;
+
+  LatchProfiler() = default;
+
+  /** @return the calling thread's table, nullptr once the thread has begun to exit */
+  auto LocalTable() -> ThreadTable *;
+  /** Fold the table of an exiting thread into retired_ and free it. */
+  void Retire(ThreadTable *table);
+
+  mutable std::mutex latch_;
+  /** Tables of the running threads that took a profiled latch. */
+  std::vector<std::unique_ptr<ThreadTable>> tables_;
+  /** Statistics of the threads that exited. */
+  std::map<SiteKey, LatchSiteStats> retired_;
+  uint64_t retired_dropped_{0};
+  std::vector<std::pair<std::string, Histogram *>> histograms_;
+};
+
+}  // namespace bustub
@@ -1,12 +1,17 @@
 #include "buffer/lru_k_replacer.h"
+#include <algorithm>
 #include <limits>
+#include <utility>
+
+#include "common/metrics.h"
 
 namespace bustub {
 
 LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) {}
 
 auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
-  std::scoped_lock<std::mutex> lock(latch_);
+  BUSTUB_METRIC_SCOPED_TIMER("replacer.evict_ns");
+  LatchGuard lock(latch_);
 
   if (curr_size_ == 0) {
     return false;
@@ -21,6 +26,7 @@ auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
 
     node_store_.erase(*frame_id);
     curr_size_--;
+    BUSTUB_METRIC_COUNT("replacer.evict", 1);
     return true;
   }
 
@@ -45,14 +51,97 @@ auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
     RemoveFromCacheList(victim_frame);  // 使用辅助函数 O(1) 删除
     node_store_.erase(victim_frame);
     curr_size_--;
+    BUSTUB_METRIC_COUNT("replacer.evict", 1);
     return true;
   }
 
   return false;
 }
 
+auto LRUKReplacer::Evict(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool {
+  BUSTUB_METRIC_SCOPED_TIMER("replacer.evict_ns");
+  LatchGuard lock(latch_);
+
+  // 与 Evict() 的顺序相同：先按 LRU 找 history_list_ 中满足条件的帧
+  for (auto it = history_list_.rbegin(); it != history_list_.rend(); ++it) {
+    if (can_evict(*it)) {
+      *frame_id = *it;
+      RemoveFromHistoryList(*frame_id);
+      node_store_.erase(*frame_id);
+      curr_size_--;
+      BUSTUB_METRIC_COUNT("replacer.evict", 1);
+      return true;
+    }
+  }
+
+  // 再在 cache_list_ 中满足条件的帧里找 k-th 时间戳最早的
+  frame_id_t victim_frame = -1;
+  size_t earliest_k_ts = std::numeric_limits<size_t>::max();
+  for (frame_id_t fid : cache_list_) {
+    size_t current_k_ts = node_store_[fid].history_.back();
+    if (current_k_ts < earliest_k_ts && can_evict(fid)) {
+      earliest_k_ts = current_k_ts;
+      victim_frame = fid;
+    }
+  }
+  if (victim_frame == -1) {
+    return false;
+  }
+
+  *frame_id = victim_frame;
+  RemoveFromCacheList(victim_frame);
+  node_store_.erase(victim_frame);
+  curr_size_--;
+  BUSTUB_METRIC_COUNT("replacer.evict", 1);
+  return true;
+}
+
+auto LRUKReplacer::EvictBatch(size_t n, std::vector<frame_id_t> *frame_ids,
+                              const std::function<bool(frame_id_t)> &can_evict) -> size_t {
+  BUSTUB_METRIC_SCOPED_TIMER("replacer.evict_batch_ns");
+  LatchGuard lock(latch_);
+
+  size_t evicted = 0;
+  auto try_evict = [&](frame_id_t fid, bool in_history) {
+    if (can_evict && !can_evict(fid)) {
+      return;
+    }
+    if (in_history) {
+      RemoveFromHistoryList(fid);
+    } else {
+      RemoveFromCacheList(fid);
+    }
+    node_store_.erase(fid);
+    curr_size_--;
+    frame_ids->push_back(fid);
+    evicted++;
+    BUSTUB_METRIC_COUNT("replacer.evict", 1);
+  };
+
+  // 1. 与 Evict() 的顺序相同：先按 LRU 顺序取 history_list_ 中的帧
+  std::vector<frame_id_t> candidates(history_list_.rbegin(), history_list_.rend());
+  for (size_t i = 0; i < candidates.size() && evicted < n; ++i) {
+    try_evict(candidates[i], true);
+  }
+  if (evicted == n) {
+    return evicted;
+  }
+
+  // 2. 再把 cache_list_ 按 k-th 时间戳排序一次，依次取最早的，而不是每个牺牲帧都扫描一遍
+  std::vector<std::pair<size_t, frame_id_t>> by_k_ts;
+  by_k_ts.reserve(cache_list_.size());
+  for (frame_id_t fid : cache_list_) {
+    by_k_ts.emplace_back(node_store_[fid].history_.back(), fid);
+  }
+  std::sort(by_k_ts.begin(), by_k_ts.end());
+  for (size_t i = 0; i < by_k_ts.size() && evicted < n; ++i) {
+    try_evict(by_k_ts[i].second, false);
+  }
+  return evicted;
+}
+
 void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
-  std::scoped_lock<std::mutex> lock(latch_);
+  LatchGuard lock(latch_);
   BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "Invalid frame ID");
 
   size_t timestamp = ++current_timestamp_;
@@ -75,7 +164,7 @@ void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
 }
 
 void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
-  std::scoped_lock<std::mutex> lock(latch_);
+  LatchGuard lock(latch_);
   BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "Invalid frame ID");
 
   auto node_it = node_store_.find(frame_id);
@@ -110,7 +199,7 @@ void LRUKReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
 }
 
 void LRUKReplacer::Remove(frame_id_t frame_id) {
-  std::scoped_lock<std::mutex> lock(latch_);
+  LatchGuard lock(latch_);
   BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "Invalid frame ID");
 
   auto node_it = node_store_.find(frame_id);
@@ -136,10 +225,44 @@ void LRUKReplacer::Remove(frame_id_t frame_id) {
 }
 
 auto LRUKReplacer::Size() -> size_t {
-  std::scoped_lock<std::mutex> lock(latch_);
+  LatchGuard lock(latch_);
   return curr_size_;
 }
 
+auto LRUKReplacer::GetHistory(frame_id_t frame_id) -> std::vector<size_t> {
+  LatchGuard lock(latch_);
+  auto node_it = node_store_.find(frame_id);
+  if (node_it == node_store_.end()) {
+    return {};
+  }
+  return {node_it->second.history_.begin(), node_it->second.history_.end()};
+}
+
+void LRUKReplacer::RestoreHistory(frame_id_t frame_id, const std::vector<size_t> &history) {
+  LatchGuard lock(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < replacer_size_, "Invalid frame ID");
+
+  auto &node = node_store_[frame_id];
+  BUSTUB_ASSERT(!node.is_evictable_, "RestoreHistory called on evictable frame");
+  node.history_.clear();
+  for (size_t timestamp : history) {
+    if (node.history_.size() == k_) {
+      break;
+    }
+    node.history_.push_back(timestamp);
+    // 保证重启之后的访问总是比恢复的历史更新
+    current_timestamp_ = std::max(current_timestamp_, timestamp);
+  }
+}
+
+void LRUKReplacer::Resize(size_t num_frames) {
+  LatchGuard lock(latch_);
+  for (const auto &[frame_id, node] : node_store_) {
+    BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames, "Resize would drop a tracked frame");
+  }
+  replacer_size_ = num_frames;
+}
+
 // --- 辅助函数实现 ---
 
 void LRUKReplacer::AddToHistoryList(frame_id_t frame_id) {
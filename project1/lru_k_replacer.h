@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <limits>
 #include <list>
 #include <mutex>  // NOLINT
@@ -20,6 +21,7 @@
 
 #include "common/config.h"
 #include "common/macros.h"
+#include "common/rwlatch.h"
 
 namespace bustub {
 
@@ -72,6 +74,31 @@ class LRUKReplacer {
    */
   auto Evict(frame_id_t *frame_id) -> bool;
 
+  /**
+   * @brief Same as Evict(), but only frames for which can_evict returns true are candidates, e.g. the frames of one
+   * buffer pool partition.
+   *
+   * @param[out] frame_id id of frame that is evicted.
+   * @param can_evict filter on the evictable frames
+   * @return true if a frame is evicted successfully, false if no frames can be evicted.
+   */
+  auto Evict(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &can_evict) -> bool;
+
+  /**
+   * @brief Evict up to n frames in one pass, in the order repeated calls to Evict() would evict them.
+   *
+   * The frames with less than k references are taken first in LRU order, then the others are sorted once by
+   * their k-th timestamp, instead of rescanning them for every victim. can_evict, if given, is called on the
+   * candidates in eviction order, so it may account for the frames already chosen.
+   *
+   * @param n maximum number of frames to evict
+   * @param[out] frame_ids the evicted frames are appended to it
+   * @param can_evict filter on the evictable frames, or nullptr to consider all of them
+   * @return the number of frames evicted
+   */
+  auto EvictBatch(size_t n, std::vector<frame_id_t> *frame_ids,
+                  const std::function<bool(frame_id_t)> &can_evict = nullptr) -> size_t;
+
   /**
    * TODO(P1): Add implementation
    *
@@ -132,6 +159,34 @@ class LRUKReplacer {
    */
   auto Size() -> size_t;
 
+  /**
+   * @brief Return the access history of a frame, newest timestamp first, e.g. to persist it across a restart.
+   *
+   * @param frame_id id of frame whose history is requested
+   * @return the recorded timestamps (at most k), empty if the frame is not tracked
+   */
+  auto GetHistory(frame_id_t frame_id) -> std::vector<size_t>;
+
+  /**
+   * @brief Replace the access history of a frame with one returned by GetHistory() before a restart.
+   *
+   * The current timestamp is advanced past the restored timestamps, so accesses made after the restart always
+   * count as more recent. The frame is left non-evictable; call SetEvictable() afterwards as usual.
+   *
+   * @param frame_id id of frame whose history is restored
+   * @param history timestamps, newest first
+   */
+  void RestoreHistory(frame_id_t frame_id, const std::vector<size_t> &history);
+
+  /**
+   * @brief Change the number of frames the replacer tracks, when the buffer pool is resized.
+   *
+   * When shrinking, frames with id >= num_frames must have been removed beforehand.
+   *
+   * @param num_frames the new number of frames
+   */
+  void Resize(size_t num_frames);
+
  private:
   // TODO(student): implement me! You can replace these member variables as you like.
   // Helper struct to store metadata for each frame
@@ -161,7 +216,7 @@ class LRUKReplacer {
   size_t curr_size_{0};  // Number of evictable frames
   size_t replacer_size_;
   size_t k_;
-  std::mutex latch_;
+  ProfiledMutex latch_{"replacer"};
 };
 
 }  // namespace bustub
@@ -0,0 +1,78 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// memory_disk_manager.cpp
+//
+// Identification: src/storage/disk/memory_disk_manager.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/memory_disk_manager.h"
+
+#include <cstring>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+auto MemoryDiskManager::PageData(page_id_t page_id) const -> char * {
+  size_t segment = static_cast<size_t>(page_id) / MEMORY_DISK_SEGMENT_PAGES;
+  if (segment >= segments_.size() || segments_[segment] == nullptr) {
+    return nullptr;
+  }
+  return segments_[segment].get() + (static_cast<size_t>(page_id) % MEMORY_DISK_SEGMENT_PAGES) * BUSTUB_PAGE_SIZE;
+}
+
+void MemoryDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  BUSTUB_ASSERT(page_id >= 0, "Invalid page id");
+
+  {
+    std::shared_lock<std::shared_mutex> lock(directory_latch_);
+    char *data = PageData(page_id);
+    if (data != nullptr) {
+      std::scoped_lock<std::mutex> page_lock(page_latches_[page_id % MEMORY_DISK_STRIPES]);
+      memcpy(data, page_data, BUSTUB_PAGE_SIZE);
+      return;
+    }
+  }
+
+  // 页所在的段还没有分配：持写锁分配，段内其余页为全零
+  std::unique_lock<std::shared_mutex> lock(directory_latch_);
+  size_t segment = static_cast<size_t>(page_id) / MEMORY_DISK_SEGMENT_PAGES;
+  if (segment >= segments_.size()) {
+    segments_.resize(segment + 1);
+  }
+  if (segments_[segment] == nullptr) {
+    segments_[segment] = std::make_unique<char[]>(MEMORY_DISK_SEGMENT_PAGES * BUSTUB_PAGE_SIZE);
+  }
+  // 持有写锁时没有其他读写者，不需要页锁
+  memcpy(PageData(page_id), page_data, BUSTUB_PAGE_SIZE);
+}
+
+void MemoryDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  BUSTUB_ASSERT(page_id >= 0, "Invalid page id");
+
+  std::shared_lock<std::shared_mutex> lock(directory_latch_);
+  char *data = PageData(page_id);
+  if (data == nullptr) {
+    // 与 DiskManager 一致：读取从未写过的页得到全零
+    memset(page_data, 0, BUSTUB_PAGE_SIZE);
+    return;
+  }
+  std::scoped_lock<std::mutex> page_lock(page_latches_[page_id % MEMORY_DISK_STRIPES]);
+  memcpy(page_data, data, BUSTUB_PAGE_SIZE);
+}
+
+auto MemoryDiskManager::GetMemoryUsage() const -> size_t {
+  std::shared_lock<std::shared_mutex> lock(directory_latch_);
+  size_t segments = 0;
+  for (const auto &segment : segments_) {
+    segments += segment != nullptr ? 1 : 0;
+  }
+  return segments * MEMORY_DISK_SEGMENT_PAGES * BUSTUB_PAGE_SIZE;
+}
+
+}  // namespace bustub
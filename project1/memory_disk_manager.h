@@ -0,0 +1,71 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// memory_disk_manager.h
+//
+// Identification: src/include/storage/disk/memory_disk_manager.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <shared_mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * MemoryDiskManager keeps the pages in memory instead of a file, so that
+ * benchmarks measure the buffer pool and the index rather than the machine's
+ * storage. Combined with ThrottledDiskManager it makes a disk whose speed is
+ * the same on every machine.
+ *
+ * Memory is allocated in segments of MEMORY_DISK_SEGMENT_PAGES pages as page
+ * ids are first written and is only freed with the disk manager. Pages that
+ * were never written read back as zeros, like with DiskManager.
+ *
+ * Usage: pass it to BufferPoolManagerInstance in place of a DiskManager.
+ */
+class MemoryDiskManager : public DiskManager {
+ public:
+  MemoryDiskManager() = default;
+
+  /**
+   * @brief Copy a page into memory.
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * @brief Copy a page out of memory.
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** @return the bytes allocated for pages */
+  auto GetMemoryUsage() const -> size_t;
+
+ private:
+  /** Pages per segment, 4 MB with the default page size. */
+  static constexpr size_t MEMORY_DISK_SEGMENT_PAGES = 1024;
+  /** Page copies take one of these latches by page id, so that they do not serialize on one. */
+  static constexpr size_t MEMORY_DISK_STRIPES = 64;
+
+  /** @return the address of the page, nullptr if its segment was never allocated; needs directory_latch_ */
+  auto PageData(page_id_t page_id) const -> char *;
+
+  /** Protects segments_ itself, held exclusively only to add segments. */
+  mutable std::shared_mutex directory_latch_;
+  std::vector<std::unique_ptr<char[]>> segments_;
+  /** Keep a reader from seeing a page half written. */
+  std::array<std::mutex, MEMORY_DISK_STRIPES> page_latches_;
+};
+
+}  // namespace bustub
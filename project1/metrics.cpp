@@ -0,0 +1,194 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// metrics.cpp
+//
+// Identification: src/common/metrics.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace bustub {
+
+auto Counter::Value() const -> uint64_t {
+  uint64_t total = 0;
+  for (const auto &shard : shards_) {
+    total += shard.value_.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void Counter::Reset() {
+  for (auto &shard : shards_) {
+    shard.value_.store(0, std::memory_order_relaxed);
+  }
+}
+
+Histogram::Histogram() {
+  for (auto &shard : shards_) {
+    shard = std::make_unique<Shard>();
+  }
+}
+
+auto Histogram::BucketUpperBound(size_t bucket) -> uint64_t {
+  if (bucket < HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  if (bucket == HISTOGRAM_BUCKETS - 1) {
+    return UINT64_MAX;
+  }
+  // 与 BucketOf() 相反：第 shift + 1 组的桶覆盖 [(16 + sub) << shift, (17 + sub) << shift)
+  size_t shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t sub = bucket % HISTOGRAM_SUB_BUCKETS;
+  return ((HISTOGRAM_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+auto Histogram::Snapshot() const -> HistogramSnapshot {
+  HistogramSnapshot snapshot;
+  snapshot.buckets_.assign(HISTOGRAM_BUCKETS, 0);
+  // 各分片分别读取，记录可能同时进行，所以快照只是近似一致
+  for (const auto &shard : shards_) {
+    snapshot.count_ += shard->count_.load(std::memory_order_relaxed);
+    snapshot.sum_ += shard->sum_.load(std::memory_order_relaxed);
+    snapshot.max_ = std::max(snapshot.max_, shard->max_.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+      snapshot.buckets_[i] += shard->buckets_[i].load(std::memory_order_relaxed);
+    }
+  }
+  return snapshot;
+}
+
+void Histogram::Reset() {
+  for (auto &shard : shards_) {
+    shard->count_.store(0, std::memory_order_relaxed);
+    shard->sum_.store(0, std::memory_order_relaxed);
+    shard->max_.store(0, std::memory_order_relaxed);
+    for (auto &bucket : shard->buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+auto HistogramSnapshot::Percentile(double q) const -> uint64_t {
+  uint64_t total = 0;
+  for (uint64_t n : buckets_) {
+    total += n;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  // 第 rank 个值（从 1 开始）所在的桶
+  auto rank = static_cast<uint64_t>(q * static_cast<double>(total) + 0.5);
+  rank = std::min(std::max<uint64_t>(rank, 1), total);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(Histogram::BucketUpperBound(i), max_);
+    }
+  }
+  return max_;
+}
+
+auto MetricsSnapshot::ToText() const -> std::string {
+  std::string out;
+  char line[512];
+  for (const auto &[name, value] : counters_) {
+    snprintf(line, sizeof(line), "%s %llu\n", name.c_str(), static_cast<unsigned long long>(value));  // NOLINT
+    out += line;
+  }
+  for (const auto &[name, histogram] : histograms_) {
+    snprintf(line, sizeof(line), "%s count=%llu mean=%.1f p50=%llu p90=%llu p99=%llu p999=%llu max=%llu\n",
+             name.c_str(), static_cast<unsigned long long>(histogram.count_), histogram.Mean(),  // NOLINT
+             static_cast<unsigned long long>(histogram.Percentile(0.5)),                         // NOLINT
+             static_cast<unsigned long long>(histogram.Percentile(0.9)),                         // NOLINT
+             static_cast<unsigned long long>(histogram.Percentile(0.99)),                        // NOLINT
+             static_cast<unsigned long long>(histogram.Percentile(0.999)),                       // NOLINT
+             static_cast<unsigned long long>(histogram.max_));                                   // NOLINT
+    out += line;
+  }
+  return out;
+}
+
+auto MetricsSnapshot::ToJson() const -> std::string {
+  std::string out = "{\"counters\":{";
+  char item[512];
+  bool first = true;
+  for (const auto &[name, value] : counters_) {
+    snprintf(item, sizeof(item), "%s\"%s\":%llu", first ? "" : ",", name.c_str(),
+             static_cast<unsigned long long>(value));  // NOLINT
+    out += item;
+    first = false;
+  }
+  out += "},\"histograms\":{";
+  first = true;
+  for (const auto &[name, histogram] : histograms_) {
+    snprintf(item, sizeof(item),
+             "%s\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+             first ? "" : ",", name.c_str(), static_cast<unsigned long long>(histogram.count_),  // NOLINT
+             histogram.Mean(), static_cast<unsigned long long>(histogram.Percentile(0.5)),       // NOLINT
+             static_cast<unsigned long long>(histogram.Percentile(0.9)),                         // NOLINT
+             static_cast<unsigned long long>(histogram.Percentile(0.99)),                        // NOLINT
+             static_cast<unsigned long long>(histogram.Percentile(0.999)),                       // NOLINT
+             static_cast<unsigned long long>(histogram.max_));                                   // NOLINT
+    out += item;
+    first = false;
+  }
+  out += "}}";
+  return out;
+}
+
+auto MetricsRegistry::Instance() -> MetricsRegistry & {
+  // 故意不析构：其他静态对象和还在运行的线程在进程退出时仍可能记录
+  static auto *registry = new MetricsRegistry();
+  return *registry;
+}
+
+auto MetricsRegistry::GetCounter(const std::string &name) -> Counter * {
+  std::scoped_lock<std::mutex> lock(latch_);
+  auto &counter = counters_[name];
+  if (counter == nullptr) {
+    counter = std::make_unique<Counter>();
+  }
+  return counter.get();
+}
+
+auto MetricsRegistry::GetHistogram(const std::string &name) -> Histogram * {
+  std::scoped_lock<std::mutex> lock(latch_);
+  auto &histogram = histograms_[name];
+  if (histogram == nullptr) {
+    histogram = std::make_unique<Histogram>();
+  }
+  return histogram.get();
+}
+
+auto MetricsRegistry::Snapshot() const -> MetricsSnapshot {
+  std::scoped_lock<std::mutex> lock(latch_);
+  MetricsSnapshot snapshot;
+  for (const auto &[name, counter] : counters_) {
+    snapshot.counters_[name] = counter->Value();
+  }
+  for (const auto &[name, histogram] : histograms_) {
+    snapshot.histograms_[name] = histogram->Snapshot();
+  }
+  return snapshot;
+}
+
+void MetricsRegistry::Reset() {
+  std::scoped_lock<std::mutex> lock(latch_);
+  for (auto &[name, counter] : counters_) {
+    counter->Reset();
+  }
+  for (auto &[name, histogram] : histograms_) {
+    histogram->Reset();
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,243 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// metrics.h
+//
+// Identification: src/include/common/metrics.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+/**
+ * Metrics are recorded through the BUSTUB_METRIC_* macros below. Build with
+ * -DBUSTUB_METRICS=0 to compile them out to nothing; the registry itself stays
+ * available and simply reports no activity.
+ */
+#ifndef BUSTUB_METRICS
+#define BUSTUB_METRICS 1
+#endif
+
+namespace bustub {
+
+/** Number of shards of a counter or histogram; threads are spread over them round-robin. */
+static constexpr size_t METRICS_SHARDS = 8;
+/** Histogram buckets per power of two, i.e. a relative error below 1/16. */
+static constexpr size_t HISTOGRAM_SUB_BUCKET_BITS = 4;
+static constexpr size_t HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS;
+/** Values of 2^HISTOGRAM_MAX_EXPONENT and more (about 18 minutes in ns) land in the last bucket. */
+static constexpr size_t HISTOGRAM_MAX_EXPONENT = 40;
+static constexpr size_t HISTOGRAM_BUCKETS =
+    (HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+/** @return the shard the calling thread records into */
+inline auto MetricsShard() -> size_t {
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARDS;
+  return shard;
+}
+
+/**
+ * A counter split into per-thread shards on separate cache lines, so that
+ * threads counting the same event do not contend on one line.
+ */
+class Counter {
+ public:
+  void Add(uint64_t n = 1) { shards_[MetricsShard()].value_.fetch_add(n, std::memory_order_relaxed); }
+
+  /** @return the sum over all shards */
+  auto Value() const -> uint64_t;
+
+  void Reset();
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value_{0};
+  };
+  std::array<Shard, METRICS_SHARDS> shards_;
+};
+
+/** Merged contents of a Histogram. */
+struct HistogramSnapshot {
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t max_{0};
+  std::vector<uint64_t> buckets_;
+
+  auto Mean() const -> double { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_; }
+
+  /** @return an upper bound of the q-quantile (0 <= q <= 1), exact up to the bucket width */
+  auto Percentile(double q) const -> uint64_t;
+};
+
+/**
+ * An HDR-style histogram of non-negative values, typically latencies in ns.
+ * Values below HISTOGRAM_SUB_BUCKETS are counted exactly; above, each power of
+ * two is split into HISTOGRAM_SUB_BUCKETS buckets. Sharded like Counter.
+ */
+class Histogram {
+ public:
+  Histogram();
+
+  void Record(uint64_t value) {
+    Shard &shard = *shards_[MetricsShard()];
+    shard.buckets_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.count_.fetch_add(1, std::memory_order_relaxed);
+    shard.sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = shard.max_.load(std::memory_order_relaxed);
+    while (value > max && !shard.max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  auto Snapshot() const -> HistogramSnapshot;
+
+  void Reset();
+
+  /** @return the bucket value falls into */
+  static auto BucketOf(uint64_t value) -> size_t {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+      return value;
+    }
+    size_t msb = 63 - __builtin_clzll(value);
+    if (msb >= HISTOGRAM_MAX_EXPONENT) {
+      return HISTOGRAM_BUCKETS - 1;
+    }
+    size_t shift = msb - HISTOGRAM_SUB_BUCKET_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + ((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+  }
+
+  /** @return the largest value of a bucket */
+  static auto BucketUpperBound(size_t bucket) -> uint64_t;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+    std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets_{};
+  };
+  // Allocated separately: a shard is several KB
+  std::array<std::unique_ptr<Shard>, METRICS_SHARDS> shards_;
+};
+
+/** Counters and histograms of a registry at one point in time, by name. */
+struct MetricsSnapshot {
+  std::map<std::string, uint64_t> counters_;
+  std::map<std::string, HistogramSnapshot> histograms_;
+
+  /** @return one line per metric: "<name> <value>" or "<name> count=... mean=... p50=..." */
+  auto ToText() const -> std::string;
+
+  /** @return {"counters": {name: value, ...}, "histograms": {name: {"count": ..., "p50": ...}, ...}} */
+  auto ToJson() const -> std::string;
+};
+
+/**
+ * The process-wide set of named metrics used by the storage stack. Metrics
+ * are created on first use and live as long as the process, so the pointers
+ * handed out stay valid; the BUSTUB_METRIC_* macros look a metric up once per
+ * call site and keep the pointer.
+ */
+class MetricsRegistry {
+ public:
+  static auto Instance() -> MetricsRegistry &;
+
+  auto GetCounter(const std::string &name) -> Counter *;
+  auto GetHistogram(const std::string &name) -> Histogram *;
+
+  auto Snapshot() const -> MetricsSnapshot;
+
+  /** Zero all metrics, e.g. between benchmark phases. */
+  void Reset();
+
+ private:
+  MetricsRegistry() = default;
+
+  mutable std::mutex latch_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+/** Records the lifetime of the object into a histogram, in ns. */
+class ScopedMetricTimer {
+ public:
+  explicit ScopedMetricTimer(Histogram *histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedMetricTimer() { histogram_->Record(ElapsedNs(start_)); }
+
+  ScopedMetricTimer(const ScopedMetricTimer &) = delete;
+  auto operator=(const ScopedMetricTimer &) -> ScopedMetricTimer & = delete;
+
+  static auto ElapsedNs(std::chrono::steady_clock::time_point start) -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+ private:
+  Histogram *histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace bustub
+
+#define BUSTUB_METRIC_CONCAT_IMPL(a, b) a##b
+#define BUSTUB_METRIC_CONCAT(a, b) BUSTUB_METRIC_CONCAT_IMPL(a, b)
+
+#if BUSTUB_METRICS
+
+/** Add n to the counter called name, which must be the same at every call of this site. */
+#define BUSTUB_METRIC_COUNT(name, n)                                     \
+  do {                                                                   \
+    static ::bustub::Counter *const bustub_metric_counter =              \
+        ::bustub::MetricsRegistry::Instance().GetCounter(name);          \
+    bustub_metric_counter->Add(n);                                       \
+  } while (0)
+
+/** Record value into the histogram called name. */
+#define BUSTUB_METRIC_RECORD(name, value)                                \
+  do {                                                                   \
+    static ::bustub::Histogram *const bustub_metric_histogram =          \
+        ::bustub::MetricsRegistry::Instance().GetHistogram(name);        \
+    bustub_metric_histogram->Record(value);                              \
+  } while (0)
+
+/** Start a timer; BUSTUB_METRIC_TIMER_RECORD(timer, name) records the ns since into a histogram. */
+#define BUSTUB_METRIC_TIMER_START(timer) const auto timer = std::chrono::steady_clock::now()
+#define BUSTUB_METRIC_TIMER_RECORD(timer, name) \
+  BUSTUB_METRIC_RECORD(name, ::bustub::ScopedMetricTimer::ElapsedNs(timer))
+
+/** Record the time until the end of the enclosing scope into the histogram called name. */
+#define BUSTUB_METRIC_SCOPED_TIMER(name)                                                        \
+  static ::bustub::Histogram *const BUSTUB_METRIC_CONCAT(bustub_metric_histogram_, __LINE__) = \
+      ::bustub::MetricsRegistry::Instance().GetHistogram(name);                                 \
+  ::bustub::ScopedMetricTimer BUSTUB_METRIC_CONCAT(bustub_metric_timer_, __LINE__)(            \
+      BUSTUB_METRIC_CONCAT(bustub_metric_histogram_, __LINE__))
+
+#else
+
+#define BUSTUB_METRIC_COUNT(name, n) \
+  do {                               \
+  } while (0)
+#define BUSTUB_METRIC_RECORD(name, value) \
+  do {                                    \
+  } while (0)
+#define BUSTUB_METRIC_TIMER_START(timer)
+#define BUSTUB_METRIC_TIMER_RECORD(timer, name) \
+  do {                                          \
+  } while (0)
+#define BUSTUB_METRIC_SCOPED_TIMER(name)
+
+#endif
@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// mmap_buffer_pool_manager.cpp
+//
+// Identification: src/buffer/mmap_buffer_pool_manager.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/mmap_buffer_pool_manager.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+MmapBufferPoolManager::MmapBufferPoolManager(const std::string &db_file, size_t readahead_pages)
+    : readahead_pages_(readahead_pages) {
+  fd_ = open(db_file.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw Exception("can't open db file " + db_file);
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    close(fd_);
+    throw Exception("can't stat db file " + db_file);
+  }
+  file_size_ = static_cast<size_t>(st.st_size);
+  num_pages_ = file_size_ / BUSTUB_PAGE_SIZE;
+
+  if (num_pages_ > 0) {
+    void *addr = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+      close(fd_);
+      throw Exception("can't mmap db file " + db_file);
+    }
+    base_ = static_cast<char *>(addr);
+  }
+
+  // 每个页只需要一个描述符：页数据直接指向映射区
+  pages_ = std::make_unique<Page[]>(num_pages_);
+  for (size_t i = 0; i < num_pages_; ++i) {
+    pages_[i].data_ = base_ + i * BUSTUB_PAGE_SIZE;
+    pages_[i].page_id_ = static_cast<page_id_t>(i);
+  }
+}
+
+MmapBufferPoolManager::~MmapBufferPoolManager() {
+  if (base_ != nullptr) {
+    munmap(base_, file_size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+auto MmapBufferPoolManager::FetchPgImp(page_id_t page_id) -> Page * {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= num_pages_) {
+    return nullptr;
+  }
+  AdviseReadahead(page_id);
+  return &pages_[page_id];
+}
+
+auto MmapBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
+  if (page_id < 0 || static_cast<size_t>(page_id) >= num_pages_) {
+    return false;
+  }
+  if (is_dirty) {
+    LOG_WARN("page %d unpinned as dirty on a read-only buffer pool", page_id);
+    return false;
+  }
+  return true;
+}
+
+auto MmapBufferPoolManager::FlushPgImp(page_id_t page_id) -> bool {
+  return page_id >= 0 && static_cast<size_t>(page_id) < num_pages_;
+}
+
+auto MmapBufferPoolManager::NewPgImp(__attribute__((unused)) page_id_t *page_id) -> Page * { return nullptr; }
+
+auto MmapBufferPoolManager::DeletePgImp(__attribute__((unused)) page_id_t page_id) -> bool { return false; }
+
+void MmapBufferPoolManager::AdviseReadahead(page_id_t page_id) {
+  page_id_t last = last_fetched_.exchange(page_id, std::memory_order_relaxed);
+  if (last == INVALID_PAGE_ID || page_id != last + 1) {
+    // 一次非顺序访问就结束当前扫描；预读窗口属于这次扫描，一并清掉，否则之后在更低页号上重新开始的扫描永远得不到预读
+    if (page_id != last) {
+      sequential_run_.store(0, std::memory_order_relaxed);
+      advised_until_.store(0, std::memory_order_relaxed);
+    }
+    return;
+  }
+  if (sequential_run_.fetch_add(1, std::memory_order_relaxed) + 1 < SEQUENTIAL_RUN_THRESHOLD) {
+    return;
+  }
+
+  // 只有当扫描快追上上一次预读的窗口时才发出新的 madvise，避免每页一次系统调用
+  page_id_t advised_until = advised_until_.load(std::memory_order_relaxed);
+  if (page_id + static_cast<page_id_t>(readahead_pages_ / 2) < advised_until && page_id < advised_until) {
+    return;
+  }
+  page_id_t begin = std::max(page_id + 1, advised_until);
+  auto end = static_cast<page_id_t>(std::min(num_pages_, static_cast<size_t>(page_id) + 1 + readahead_pages_));
+  if (begin >= end) {
+    return;
+  }
+  advised_until_.store(end, std::memory_order_relaxed);
+
+  char *addr = base_ + static_cast<size_t>(begin) * BUSTUB_PAGE_SIZE;
+  size_t length = static_cast<size_t>(end - begin) * BUSTUB_PAGE_SIZE;
+  madvise(addr, length, MADV_SEQUENTIAL);
+  madvise(addr, length, MADV_WILLNEED);
+}
+
+}  // namespace bustub
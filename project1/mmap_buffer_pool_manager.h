@@ -0,0 +1,106 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// mmap_buffer_pool_manager.h
+//
+// Identification: src/include/buffer/mmap_buffer_pool_manager.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/config.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * MmapBufferPoolManager serves pages of a database file that is mapped read-only into memory.
+ *
+ * It is meant for read-mostly snapshots (e.g. a read replica): there are no frames, no page table and no
+ * replacer. FetchPage() returns a Page whose data points directly into the mapping, so nothing is copied and
+ * the memory is the OS page cache, shared with every other process mapping the same file. Opening is O(1) in
+ * the size of the file apart from one small descriptor per page.
+ *
+ * Operations that would modify the file are rejected: NewPage() returns nullptr, DeletePage() returns false,
+ * and UnpinPage() returns false if the page is marked dirty. Writing into a fetched page faults.
+ *
+ * Sequential fetches (page_id, page_id + 1, ...), as produced by IndexIterator walking a leaf chain laid out
+ * in an extent, are detected and the pages ahead of the scan are advised with MADV_SEQUENTIAL/MADV_WILLNEED.
+ * Detection tracks a single scan for the whole pool: when several threads scan at once their fetches
+ * interleave, no fetch follows its predecessor, and none of the scans gets advice.
+ */
+class MmapBufferPoolManager : public BufferPoolManager {
+ public:
+  /**
+   * @brief Map a database file read-only.
+   * @param db_file the database file
+   * @param readahead_pages number of pages to advise ahead of a detected sequential scan
+   */
+  explicit MmapBufferPoolManager(const std::string &db_file, size_t readahead_pages = 64);
+
+  ~MmapBufferPoolManager() override;
+
+  DISALLOW_COPY_AND_MOVE(MmapBufferPoolManager);
+
+  /** @return the number of pages in the mapped file */
+  auto GetPoolSize() -> size_t override { return num_pages_; }
+
+ protected:
+  /**
+   * @brief Return a view of the page inside the mapping.
+   * @return nullptr if page_id is outside the file
+   */
+  auto FetchPgImp(page_id_t page_id) -> Page * override;
+
+  /**
+   * @brief Nothing to release; pages are never evicted.
+   * @return false if the page is outside the file or is_dirty is set
+   */
+  auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool override;
+
+  /** @brief The mapping is read-only, so there is nothing to flush. */
+  auto FlushPgImp(page_id_t page_id) -> bool override;
+
+  /** @brief Not supported on a read-only mapping. */
+  auto NewPgImp(page_id_t *page_id) -> Page * override;
+
+  /** @brief Not supported on a read-only mapping. */
+  auto DeletePgImp(page_id_t page_id) -> bool override;
+
+  /** @brief The mapping is read-only, so there is nothing to flush. */
+  void FlushAllPgsImp() override {}
+
+ private:
+  /**
+   * @brief Track the fetch order and advise the kernel to read ahead when page_id continues a sequential run.
+   */
+  void AdviseReadahead(page_id_t page_id);
+
+  /** Minimum length of a run of consecutive fetches before it is treated as a scan. */
+  static constexpr int SEQUENTIAL_RUN_THRESHOLD = 2;
+
+  int fd_{-1};
+  char *base_{nullptr};
+  size_t file_size_{0};
+  size_t num_pages_{0};
+  const size_t readahead_pages_;
+  /** One descriptor per page of the file, pages_[page_id].data_ points into the mapping. */
+  std::unique_ptr<Page[]> pages_;
+
+  /** Scan detection, best effort: racing scans only cost extra or missing advice. */
+  std::atomic<page_id_t> last_fetched_{INVALID_PAGE_ID};
+  std::atomic<int> sequential_run_{0};
+  /** End of the pages advised for the current run; reset when the run ends. */
+  std::atomic<page_id_t> advised_until_{0};
+};
+
+}  // namespace bustub
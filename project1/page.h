@@ -0,0 +1,161 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page.h
+//
+// Identification: src/include/storage/page/page.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "common/rwlatch.h"
+
+namespace bustub {
+
+/** Size of a cache line. Page objects are aligned to it, so that the metadata of neighbouring frames never shares a
+ * line. */
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
+ * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
+ * pin count, dirty flag, page id, etc.
+ *
+ * The page data itself is not part of the Page object: data_ points into memory owned by the buffer pool manager
+ * (its frame arena, or a file mapping for MmapBufferPoolManager). Page objects are cache-line aligned descriptors,
+ * so that threads pinning and latching adjacent frames don't contend on the same cache lines.
+ */
+class alignas(CACHE_LINE_SIZE) Page {
+  // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
+  friend class BufferPoolManagerInstance;
+  friend class MmapBufferPoolManager;
+
+ public:
+  /** Constructor. The buffer pool manager attaches the page data. */
+  Page() = default;
+
+  /** Default destructor. */
+  ~Page() = default;
+
+  /** @return the actual data contained within this page */
+  inline auto GetData() -> char * { return data_; }
+
+  /** @return the page id of this page */
+  inline auto GetPageId() -> page_id_t { return page_id_; }
+
+  /** @return the pin count of this page */
+  inline auto GetPinCount() -> int { return pin_count_; }
+
+  /** @return true if the page in memory has been modified from the page on disk, false otherwise */
+  inline auto IsDirty() -> bool {
+    return dirty_bits_ != nullptr ? (dirty_bits_->load() & dirty_mask_) != 0 : is_dirty_.load();
+  }
+
+  /**
+   * Add a pin to a page the caller already holds pinned, without going through the buffer pool manager: a pinned
+   * page cannot be evicted, so its frame and its page table entry stay where they are.
+   */
+  inline void Pin() {
+    int old_pin_count = pin_count_.fetch_add(1);
+    BUSTUB_ASSERT(old_pin_count > 0, "Page::Pin() needs a page that is already pinned");
+  }
+
+  /**
+   * Drop a pin without going through the buffer pool manager. The last pin is never dropped here, since the
+   * replacer has to learn that the frame became evictable; the caller then unpins through the buffer pool manager.
+   * @return true if a pin was dropped, false if this is the last pin
+   */
+  inline auto Unpin(bool is_dirty) -> bool {
+    // mark the page dirty while we still hold our pin, so that it cannot be evicted clean
+    if (is_dirty) {
+      SetDirty(true);
+    }
+    int pin_count = pin_count_;
+    while (pin_count > 1) {
+      if (pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** Acquire the page write latch. The call site is recorded when latches are profiled. */
+  inline void WLatch(const char *site = __builtin_FUNCTION(), int line = __builtin_LINE()) {
+    rwlatch_.WLock(site, line);
+  }
+
+  /** Release the page write latch. */
+  inline void WUnlatch() { rwlatch_.WUnlock(); }
+
+  /** Acquire the page read latch. */
+  inline void RLatch(const char *site = __builtin_FUNCTION(), int line = __builtin_LINE()) {
+    rwlatch_.RLock(site, line);
+  }
+
+  /** Release the page read latch. */
+  inline void RUnlatch() { rwlatch_.RUnlock(); }
+
+  /** @return the page LSN. */
+  inline auto GetLSN() -> lsn_t { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
+
+  /** Sets the page LSN. */
+  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t)); }
+
+ protected:
+  static_assert(sizeof(page_id_t) == 4);
+  static_assert(sizeof(lsn_t) == 4);
+
+  static constexpr size_t SIZE_PAGE_HEADER = 8;
+  static constexpr size_t OFFSET_PAGE_START = 0;
+  static constexpr size_t OFFSET_LSN = 4;
+
+ private:
+  /** Zeroes out the data that is held within the page. */
+  inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, BUSTUB_PAGE_SIZE); }
+
+  /**
+   * Sets or clears the dirty state: the page's bit in the dirty bitmap of its buffer pool if it has one, is_dirty_
+   * otherwise. Keeping it in one place makes each update a single atomic step, so concurrent setters and clearers
+   * cannot leave the page looking dirty to one reader and clean to another.
+   */
+  inline void SetDirty(bool is_dirty) {
+    if (dirty_bits_ == nullptr) {
+      is_dirty_ = is_dirty;
+    } else if (is_dirty) {
+      dirty_bits_->fetch_or(dirty_mask_);
+    } else {
+      dirty_bits_->fetch_and(~dirty_mask_);
+    }
+  }
+
+  /** The actual data that is stored within a page, BUSTUB_PAGE_SIZE bytes owned by the buffer pool manager. */
+  char *data_{nullptr};
+  /** The ID of this page. */
+  page_id_t page_id_ = INVALID_PAGE_ID;
+  /** The pin count of this page. Atomic, since Pin() and Unpin() change it without the buffer pool manager latch. */
+  std::atomic<int> pin_count_ = 0;
+  /** True if the page is dirty, i.e. it is different from its corresponding page on disk. Only used when the
+   * page has no bit in a dirty bitmap. */
+  std::atomic<bool> is_dirty_ = false;
+  /** Word of the buffer pool's dirty bitmap that holds this page's bit, or nullptr. */
+  std::atomic<uint64_t> *dirty_bits_{nullptr};
+  /** This page's bit in *dirty_bits_. */
+  uint64_t dirty_mask_{0};
+  /** Number of the latest copy the buffer pool took of this page to write it back. A write of an older copy may
+   * land on disk after a newer one, so it marks the page dirty again. */
+  std::atomic<uint64_t> snapshot_seq_{0};
+  /** Page latch. */
+  ReaderWriterLatch rwlatch_{"page"};
+};
+
+}  // namespace bustub
@@ -0,0 +1,114 @@
+#include "storage/disk/page_codec.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+constexpr auto MakeCrc32Table() -> std::array<uint32_t, 256> {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) != 0 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+constexpr std::array<uint32_t, 256> CRC32_TABLE = MakeCrc32Table();
+
+void PutVarint(size_t value, std::string *out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+auto GetVarint(const char **pos, const char *end, size_t *value) -> bool {
+  size_t result = 0;
+  for (int shift = 0; *pos < end && shift < 64; shift += 7) {
+    auto byte = static_cast<uint8_t>(*(*pos)++);
+    result |= static_cast<size_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+void PageCodec::Compress(const char *src, size_t len, std::string *out) {
+  size_t pos = 0;
+  while (pos < len) {
+    // 找到下一个足够长的零段（或结尾处的零段），之前的都是字面量
+    size_t zero_start = len;
+    size_t i = pos;
+    while (i < len) {
+      if (src[i] != 0) {
+        ++i;
+        continue;
+      }
+      size_t j = i;
+      while (j < len && src[j] == 0) {
+        ++j;
+      }
+      if (j - i >= MIN_ZERO_RUN || j == len) {
+        zero_start = i;
+        break;
+      }
+      i = j;
+    }
+
+    size_t zero_end = zero_start;
+    while (zero_end < len && src[zero_end] == 0) {
+      ++zero_end;
+    }
+
+    PutVarint(zero_start - pos, out);
+    out->append(src + pos, zero_start - pos);
+    PutVarint(zero_end - zero_start, out);
+    pos = zero_end;
+  }
+}
+
+auto PageCodec::Decompress(const char *src, size_t len, char *dst, size_t dst_len) -> bool {
+  const char *pos = src;
+  const char *end = src + len;
+  size_t written = 0;
+  while (pos < end) {
+    size_t literal_len;
+    if (!GetVarint(&pos, end, &literal_len) || literal_len > static_cast<size_t>(end - pos) ||
+        literal_len > dst_len - written) {
+      return false;
+    }
+    memcpy(dst + written, pos, literal_len);
+    pos += literal_len;
+    written += literal_len;
+
+    size_t zero_len;
+    if (!GetVarint(&pos, end, &zero_len) || zero_len > dst_len - written) {
+      return false;
+    }
+    memset(dst + written, 0, zero_len);
+    written += zero_len;
+  }
+  return written == dst_len;
+}
+
+auto PageCodec::Crc32(const char *data, size_t len) -> uint32_t {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc = CRC32_TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+}  // namespace bustub
@@ -0,0 +1,56 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// page_codec.h
+//
+// Identification: src/include/storage/disk/page_codec.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bustub {
+
+/**
+ * PageCodec is a small, dependency-free page compressor.
+ *
+ * B+ tree pages are mostly zeros: the unused tail after the last slot, and the
+ * padding inside GenericKey<N> when the key is narrower than N bytes. The codec
+ * encodes a page as a sequence of (literal run, zero run) pairs:
+ *
+ *  ------------------------------------------------------------------
+ * | varint(literal_len) | literal bytes | varint(zero_len) | ...
+ *  ------------------------------------------------------------------
+ *
+ * Zero runs shorter than MIN_ZERO_RUN are kept inside the literal run.
+ */
+class PageCodec {
+ public:
+  /** Zero runs shorter than this are cheaper to store as literals. */
+  static constexpr size_t MIN_ZERO_RUN = 4;
+
+  /**
+   * @brief Append the encoded form of src[0, len) to out.
+   */
+  static void Compress(const char *src, size_t len, std::string *out);
+
+  /**
+   * @brief Decode src[0, len) into dst, which must hold exactly dst_len bytes.
+   * @return false if the input is malformed or does not decode to dst_len bytes
+   */
+  static auto Decompress(const char *src, size_t len, char *dst, size_t dst_len) -> bool;
+
+  /**
+   * @brief CRC-32 (IEEE 802.3) of data[0, len), for callers that store encoded data in files.
+   */
+  static auto Crc32(const char *data, size_t len) -> uint32_t;
+};
+
+}  // namespace bustub
@@ -0,0 +1,187 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// rwlatch.h
+//
+// Identification: src/include/common/rwlatch.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <mutex>   // NOLINT
+#include <shared_mutex>
+
+#include "common/latch_profiler.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * Reader-Writer latch backed by std::shared_mutex.
+ *
+ * The lock functions take the call site as default arguments, so that the
+ * latch profiler can tell who acquires a latch and who holds it while others
+ * wait. Wrappers such as Page::WLatch() forward their own caller.
+ */
+class ReaderWriterLatch {
+ public:
+  /** @param name the name the latch profiler reports this kind of latch under */
+  explicit ReaderWriterLatch([[maybe_unused]] const char *name = "rwlatch") {
+#if BUSTUB_LATCH_PROFILE
+    name_ = name;
+    wait_histogram_ = LatchProfiler::Instance().WaitHistogram(name);
+#endif
+  }
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock([[maybe_unused]] const char *site = __builtin_FUNCTION(),
+             [[maybe_unused]] int line = __builtin_LINE()) {
+#if BUSTUB_LATCH_PROFILE
+    if (mutex_.try_lock()) {
+      LatchProfiler::Instance().Record(name_, LatchMode::EXCLUSIVE, site, line, false, 0, nullptr, 0);
+    } else {
+      const char *holder = holder_.load(std::memory_order_relaxed);
+      int holder_line = holder_line_.load(std::memory_order_relaxed);
+      auto start = std::chrono::steady_clock::now();
+      mutex_.lock();
+      uint64_t wait_ns = ScopedMetricTimer::ElapsedNs(start);
+      wait_histogram_->Record(wait_ns);
+      LatchProfiler::Instance().Record(name_, LatchMode::EXCLUSIVE, site, line, true, wait_ns, holder, holder_line);
+    }
+    // The two halves of the holder may be seen torn by a waiter; it is only a tag
+    holder_.store(site, std::memory_order_relaxed);
+    holder_line_.store(line, std::memory_order_relaxed);
+#else
+    mutex_.lock();
+#endif
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() {
+#if BUSTUB_LATCH_PROFILE
+    holder_.store(nullptr, std::memory_order_relaxed);
+#endif
+    mutex_.unlock();
+  }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock([[maybe_unused]] const char *site = __builtin_FUNCTION(),
+             [[maybe_unused]] int line = __builtin_LINE()) {
+#if BUSTUB_LATCH_PROFILE
+    if (mutex_.try_lock_shared()) {
+      LatchProfiler::Instance().Record(name_, LatchMode::SHARED, site, line, false, 0, nullptr, 0);
+    } else {
+      const char *holder = holder_.load(std::memory_order_relaxed);
+      int holder_line = holder_line_.load(std::memory_order_relaxed);
+      auto start = std::chrono::steady_clock::now();
+      mutex_.lock_shared();
+      uint64_t wait_ns = ScopedMetricTimer::ElapsedNs(start);
+      wait_histogram_->Record(wait_ns);
+      LatchProfiler::Instance().Record(name_, LatchMode::SHARED, site, line, true, wait_ns, holder, holder_line);
+    }
+#else
+    mutex_.lock_shared();
+#endif
+  }
+
+  /**
+   * Release a read latch.
+   */
+  void RUnlock() { mutex_.unlock_shared(); }
+
+ private:
+  std::shared_mutex mutex_;
+#if BUSTUB_LATCH_PROFILE
+  const char *name_;
+  Histogram *wait_histogram_;
+  /** Call site of the current exclusive holder, nullptr while not held exclusively. */
+  std::atomic<const char *> holder_{nullptr};
+  std::atomic<int> holder_line_{0};
+#endif
+};
+
+/**
+ * Exclusive latch backed by std::mutex, profiled like ReaderWriterLatch. Take
+ * it with LatchGuard to have the call site recorded; lock() and unlock() make
+ * it usable with the standard lock types as well, under an unknown site.
+ */
+class ProfiledMutex {
+ public:
+  /** @param name the name the latch profiler reports this kind of latch under */
+  explicit ProfiledMutex([[maybe_unused]] const char *name = "mutex") {
+#if BUSTUB_LATCH_PROFILE
+    name_ = name;
+    wait_histogram_ = LatchProfiler::Instance().WaitHistogram(name);
+#endif
+  }
+
+  void Lock([[maybe_unused]] const char *site = __builtin_FUNCTION(),
+            [[maybe_unused]] int line = __builtin_LINE()) {
+#if BUSTUB_LATCH_PROFILE
+    if (mutex_.try_lock()) {
+      LatchProfiler::Instance().Record(name_, LatchMode::EXCLUSIVE, site, line, false, 0, nullptr, 0);
+    } else {
+      const char *holder = holder_.load(std::memory_order_relaxed);
+      int holder_line = holder_line_.load(std::memory_order_relaxed);
+      auto start = std::chrono::steady_clock::now();
+      mutex_.lock();
+      uint64_t wait_ns = ScopedMetricTimer::ElapsedNs(start);
+      wait_histogram_->Record(wait_ns);
+      LatchProfiler::Instance().Record(name_, LatchMode::EXCLUSIVE, site, line, true, wait_ns, holder, holder_line);
+    }
+    holder_.store(site, std::memory_order_relaxed);
+    holder_line_.store(line, std::memory_order_relaxed);
+#else
+    mutex_.lock();
+#endif
+  }
+
+  void Unlock() {
+#if BUSTUB_LATCH_PROFILE
+    holder_.store(nullptr, std::memory_order_relaxed);
+#endif
+    mutex_.unlock();
+  }
+
+  void lock() { Lock("(unknown)", 0); }  // NOLINT
+  void unlock() { Unlock(); }            // NOLINT
+
+ private:
+  std::mutex mutex_;
+#if BUSTUB_LATCH_PROFILE
+  const char *name_;
+  Histogram *wait_histogram_;
+  std::atomic<const char *> holder_{nullptr};
+  std::atomic<int> holder_line_{0};
+#endif
+};
+
+/** Holds a ProfiledMutex for its lifetime, like std::scoped_lock, recording the site it was created at. */
+class LatchGuard {
+ public:
+  explicit LatchGuard(ProfiledMutex &mutex, const char *site = __builtin_FUNCTION(), int line = __builtin_LINE())
+      : mutex_(mutex) {
+    mutex_.Lock(site, line);
+  }
+  ~LatchGuard() { mutex_.Unlock(); }
+
+  LatchGuard(const LatchGuard &) = delete;
+  auto operator=(const LatchGuard &) -> LatchGuard & = delete;
+
+ private:
+  ProfiledMutex &mutex_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,85 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// throttled_disk_manager.cpp
+//
+// Identification: src/storage/disk/throttled_disk_manager.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/throttled_disk_manager.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT
+
+#include "common/config.h"
+#include "common/metrics.h"
+
+namespace bustub {
+
+ThrottledDiskManager::ThrottledDiskManager(DiskManager *disk_manager, const Options &options)
+    : disk_manager_(disk_manager),
+      read_latency_(std::chrono::microseconds(options.read_latency_us_)),
+      write_latency_(std::chrono::microseconds(options.write_latency_us_)),
+      service_time_(0),
+      device_free_(Clock::now()) {
+  // 每页占用设备的时间取 IOPS 与带宽两个限制中更严的一个
+  if (options.iops_ != 0) {
+    service_time_ = std::max(service_time_, std::chrono::nanoseconds(1000000000ULL / options.iops_));
+  }
+  if (options.bandwidth_bytes_per_sec_ != 0) {
+    service_time_ = std::max(service_time_, std::chrono::nanoseconds(1000000000ULL * BUSTUB_PAGE_SIZE /
+                                                                      options.bandwidth_bytes_per_sec_));
+  }
+}
+
+auto ThrottledDiskManager::Schedule(Clock::time_point now, std::chrono::nanoseconds latency) -> Clock::time_point {
+  Clock::time_point start;
+  {
+    std::scoped_lock<std::mutex> lock(latch_);
+    // 设备空闲时从现在开始服务，否则排在之前的请求后面
+    start = std::max(now, device_free_);
+    device_free_ = start + service_time_;
+  }
+  queue_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(start - now).count();
+  return start + std::max(latency, service_time_);
+}
+
+void ThrottledDiskManager::WaitUntil(Clock::time_point deadline) {
+  auto start = Clock::now();
+  if (start < deadline) {
+    // 长等待先睡到快到期，剩下的一小段自旋，以免调度器睡过头
+    if (deadline - start > SPIN_THRESHOLD) {
+      std::this_thread::sleep_for(deadline - start - SPIN_THRESHOLD);
+    }
+    while (Clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+  }
+  delay_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+void ThrottledDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  BUSTUB_METRIC_SCOPED_TIMER("disk.write_ns");
+  auto deadline = Schedule(Clock::now(), write_latency_);
+  disk_manager_->WritePage(page_id, page_data);
+  pages_written_++;
+  WaitUntil(deadline);
+}
+
+void ThrottledDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  BUSTUB_METRIC_SCOPED_TIMER("disk.read_ns");
+  auto deadline = Schedule(Clock::now(), read_latency_);
+  disk_manager_->ReadPage(page_id, page_data);
+  pages_read_++;
+  WaitUntil(deadline);
+}
+
+auto ThrottledDiskManager::GetStats() const -> Stats {
+  return {pages_read_.load(), pages_written_.load(), queue_ns_.load(), delay_ns_.load()};
+}
+
+}  // namespace bustub
@@ -0,0 +1,106 @@
+//===----------------------------------------------------------------------===//
+//
+//                          BusTub
+//
+// throttled_disk_manager.h
+//
+// Identification: src/include/storage/disk/throttled_disk_manager.h
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * ThrottledDiskManager makes another disk manager behave like a slower device,
+ * so that out-of-core runs give the same results on a laptop, a CI runner and
+ * a server with fast NVMe.
+ *
+ * The simulated device serves one page at a time. A page occupies it for
+ * 1 / iops seconds or BUSTUB_PAGE_SIZE / bandwidth seconds, whichever is
+ * longer, and completes when it has been served or the read or write latency
+ * after it started being served, whichever is later. Requests of concurrent
+ * threads queue for the device, while their latencies overlap, as with the
+ * queue of an SSD. The calling thread does the I/O on the wrapped disk
+ * manager and then waits until the completion time, so the wrapped disk
+ * manager should be faster than the simulated one; a MemoryDiskManager makes
+ * the timing independent of the machine.
+ *
+ * The wrapped disk manager is not owned; shut it down and delete it after
+ * this one.
+ */
+class ThrottledDiskManager : public DiskManager {
+ public:
+  /** Speed of the simulated device; 0 means no limit. */
+  struct Options {
+    uint64_t read_latency_us_{0};
+    uint64_t write_latency_us_{0};
+    uint64_t bandwidth_bytes_per_sec_{0};
+    uint64_t iops_{0};
+  };
+
+  /** Statistics of the I/O so far. */
+  struct Stats {
+    uint64_t pages_read_;
+    uint64_t pages_written_;
+    /** Time requests waited for the device to finish earlier requests. */
+    uint64_t queue_ns_;
+    /** Time the calling threads were held back after their I/O on the wrapped disk manager. */
+    uint64_t delay_ns_;
+  };
+
+  ThrottledDiskManager(DiskManager *disk_manager, const Options &options);
+
+  /**
+   * @brief Write a page through the wrapped disk manager, taking as long as the simulated device.
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * @brief Read a page through the wrapped disk manager, taking as long as the simulated device.
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** @return a snapshot of the statistics */
+  auto GetStats() const -> Stats;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  /** Waits shorter than this spin instead of sleeping, since the scheduler may oversleep by more. */
+  static constexpr std::chrono::microseconds SPIN_THRESHOLD{100};
+
+  /** Reserve the device for one page; @return when the request completes */
+  auto Schedule(Clock::time_point now, std::chrono::nanoseconds latency) -> Clock::time_point;
+
+  /** Hold the calling thread back until deadline. */
+  void WaitUntil(Clock::time_point deadline);
+
+  DiskManager *disk_manager_;
+  std::chrono::nanoseconds read_latency_;
+  std::chrono::nanoseconds write_latency_;
+  /** Time the device is busy per page. */
+  std::chrono::nanoseconds service_time_;
+
+  /** Protects device_free_. */
+  std::mutex latch_;
+  /** When the device has served all requests so far. */
+  Clock::time_point device_free_;
+
+  std::atomic<uint64_t> pages_read_{0};
+  std::atomic<uint64_t> pages_written_{0};
+  std::atomic<uint64_t> queue_ns_{0};
+  std::atomic<uint64_t> delay_ns_{0};
+};
+
+}  // namespace bustub
@@ -1,7 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/macros.h"
+#include "common/metrics.h"
 #include "common/rid.h"
 #include "storage/index/b_plus_tree.h"
 #include "storage/page/header_page.h"
@@ -9,13 +20,42 @@
 namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, size_t page_size, partition_id_t partition)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
-      leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      page_size_(page_size),
+      leaf_max_size_(leaf_max_size > 0 ? leaf_max_size : LeafPage::Capacity(page_size)),
+      internal_max_size_(internal_max_size > 0 ? internal_max_size : InternalPage::Capacity(page_size)),
+      partition_(partition) {
+  // A node must fit in one buffer pool frame
+  BUSTUB_ASSERT(page_size_ >= BPLUSTREE_MIN_PAGE_SIZE && page_size_ <= static_cast<size_t>(BUSTUB_PAGE_SIZE) &&
+                    (page_size_ & (page_size_ - 1)) == 0,
+                "B+ tree page size must be a power of two between BPLUSTREE_MIN_PAGE_SIZE and BUSTUB_PAGE_SIZE");
+  // Leaves hold up to leaf_max_size_ entries (internal nodes internal_max_size_) right before they split
+  BUSTUB_ASSERT(leaf_max_size_ >= 2 && leaf_max_size_ <= LeafPage::Capacity(page_size_),
+                "leaf_max_size does not fit in a page");
+  BUSTUB_ASSERT(internal_max_size_ >= 3 && internal_max_size_ <= InternalPage::Capacity(page_size_),
+                "internal_max_size does not fit in a page");
+}
+
+/*
+ * Drop the pins of the pinned top levels, and release the page ids of the
+ * extent that no leaf was allocated from yet; otherwise the frames stay
+ * pinned for good and the ids reserved until the database is reopened.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_TYPE::~BPlusTree() {
+  // No iterator outlives the tree, so nothing pins the pending pages any more
+  RetryPendingDeletes();
+  for (const auto &[page_id, page] : pinned_pages_) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+  if (extent_next_ != extent_end_) {
+    buffer_pool_manager_->ReleaseExtent(extent_next_, extent_end_ - extent_next_);
+  }
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
@@ -61,30 +101,45 @@ auto BPLUSTREE_TYPE::IsSafe(N *node, Operation op) -> bool {
 
 /*
  * Unlock and unpin all pages stored in transaction's page set
+ * Pages of the pinned top levels keep their permanent pin. If the operation
+ * changed the pinned levels, they are rebuilt before the root latch is
+ * released, and only then are the deleted pages dropped.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UnlockUnpinPages(Transaction *transaction) {
   if (transaction == nullptr) {
     return;
   }
+  bool holds_root_latch = false;
   auto page_set = transaction->GetPageSet();
   for (auto *page : *page_set) {
     if (page == nullptr) {
       // nullptr marks that we hold root latch
-      root_latch_.WUnlock();
+      holds_root_latch = true;
     } else {
       page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      if (pinned_pages_.count(page->GetPageId()) == 0) {
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      }
     }
   }
   page_set->clear();
 
+  if (holds_root_latch && pinned_stale_) {
+    RefreshPinnedLevels();
+  }
+
   // Delete pages marked for deletion
   auto deleted_page_set = transaction->GetDeletedPageSet();
   for (auto page_id : *deleted_page_set) {
-    buffer_pool_manager_->DeletePage(page_id);
+    DeletePageOrDefer(page_id);
   }
   deleted_page_set->clear();
+  RetryPendingDeletes();
+
+  if (holds_root_latch) {
+    root_latch_.WUnlock();
+  }
 }
 
 /*
@@ -136,7 +191,10 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation o
     return nullptr;
   }
 
-  auto *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  // Readers keep the root latch while they walk the pinned top levels, which
+  // is what keeps those pages in place; writers hold it for the whole operation
+  bool pinned;
+  auto *page = FetchNode(root_page_id_, &pinned);
   if (page == nullptr) {
     if (op == Operation::SEARCH) {
       root_latch_.RUnlock();
@@ -148,12 +206,15 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation o
     }
     return nullptr;
   }
-  
+
   auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  bool holds_root_latch = op == Operation::SEARCH && pinned;
 
   if (op == Operation::SEARCH) {
     page->RLatch();
-    root_latch_.RUnlock();
+    if (!holds_root_latch) {
+      root_latch_.RUnlock();
+    }
   } else {
     page->WLatch();
     if (transaction != nullptr) {
@@ -170,12 +231,20 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation o
       child_page_id = internal->Lookup(key, comparator_);
     }
 
-    auto *child_page = buffer_pool_manager_->FetchPage(child_page_id);
+    bool child_pinned = false;
+    auto *child_page = op != Operation::SEARCH || holds_root_latch
+                           ? FetchNode(child_page_id, &child_pinned)
+                           : buffer_pool_manager_->FetchPage(child_page_id, partition_);
     if (child_page == nullptr) {
       // Failed to fetch child page, release all locks and return
       if (op == Operation::SEARCH) {
         page->RUnlatch();
-        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        if (!pinned) {
+          buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        }
+        if (holds_root_latch) {
+          root_latch_.RUnlock();
+        }
       } else {
         if (transaction != nullptr) {
           UnlockUnpinPages(transaction);
@@ -183,13 +252,19 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation o
       }
       return nullptr;
     }
-    
+
     auto *child_node = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
 
     if (op == Operation::SEARCH) {
       child_page->RLatch();
       page->RUnlatch();
-      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      if (!pinned) {
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      }
+      if (holds_root_latch && !child_pinned) {
+        root_latch_.RUnlock();
+        holds_root_latch = false;
+      }
     } else {
       child_page->WLatch();
       // For INSERT/DELETE: always keep all ancestors locked (simpler strategy)
@@ -201,6 +276,15 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation o
 
     node = child_node;
     page = child_page;
+    pinned = child_pinned;
+  }
+
+  // The caller unpins the leaf, so a leaf of the pinned levels gets a regular pin
+  if (pinned) {
+    buffer_pool_manager_->FetchPage(page->GetPageId(), partition_);
+  }
+  if (holds_root_latch) {
+    root_latch_.RUnlock();
   }
 
   // For write operations, remove the leaf page from page_set since we return it separately
@@ -218,6 +302,7 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation o
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) -> bool {
+  BUSTUB_METRIC_SCOPED_TIMER("btree.lookup_ns");
   auto *page = FindLeafPage(key, false, Operation::SEARCH, transaction);
   if (page == nullptr) {
     return false;
@@ -237,6 +322,200 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
   return found;
 }
 
+/*****************************************************************************
+ * PAGE ALLOCATION
+ *****************************************************************************/
+/*
+ * Allocate a new leaf page from this tree's extent, so that the leaves of one
+ * tree stay physically clustered even when several trees grow at the same
+ * time. A new extent is reserved when the current one is used up. Falls back
+ * to a page close to hint if the buffer pool does not support extents.
+ * Caller must hold root_latch_ in write mode.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::NewLeafPage(page_id_t *page_id, page_id_t hint) -> Page * {
+  if (extent_next_ == extent_end_) {
+    page_id_t first = buffer_pool_manager_->ReserveExtent(BPLUSTREE_EXTENT_SIZE);
+    if (first != INVALID_PAGE_ID) {
+      extent_next_ = first;
+      extent_end_ = first + BPLUSTREE_EXTENT_SIZE;
+    }
+  }
+
+  if (extent_next_ == extent_end_) {
+    return buffer_pool_manager_->NewPage(page_id, hint, partition_);
+  }
+
+  auto *page = buffer_pool_manager_->NewPage(page_id, extent_next_, partition_);
+  if (page != nullptr && *page_id == extent_next_) {
+    extent_next_++;
+  }
+  return page;
+}
+
+/*****************************************************************************
+ * PINNED TOP LEVELS
+ *****************************************************************************/
+/*
+ * Keep the nodes of the top levels of the tree permanently pinned, so that
+ * operations reach them through pinned_pages_ instead of a FetchPage and
+ * UnpinPage round trip each. levels = 0 releases them again; the destructor
+ * releases them too.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::PinTopLevels(int levels) {
+  root_latch_.WLock();
+  pinned_levels_ = std::max(levels, 0);
+  RefreshPinnedLevels();
+  root_latch_.WUnlock();
+}
+
+/*
+ * Return the page of a node, from pinned_pages_ if it is one of the pinned
+ * top levels (then *pinned is set and the page must not be unpinned), from the
+ * buffer pool manager otherwise. Caller must hold root_latch_.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FetchNode(page_id_t page_id, bool *pinned) -> Page * {
+  auto it = pinned_pages_.find(page_id);
+  *pinned = it != pinned_pages_.end();
+  return *pinned ? it->second : buffer_pool_manager_->FetchPage(page_id, partition_);
+}
+
+/*
+ * Pin the nodes of the top pinned_levels_ levels and drop the pins of the
+ * nodes that are no longer among them, e.g. after the root split or a pinned
+ * node was split or merged. At most half of the buffer pool is pinned this
+ * way; nodes beyond that are simply fetched as usual.
+ * Caller must hold root_latch_ in write mode.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RefreshPinnedLevels() {
+  std::unordered_map<page_id_t, Page *> pinned_pages;
+  const size_t max_pinned = buffer_pool_manager_->GetPoolSize() / 2;
+  std::vector<page_id_t> level;
+  if (pinned_levels_ > 0 && !IsEmpty()) {
+    level.push_back(root_page_id_);
+  }
+  for (int depth = 0; depth < pinned_levels_ && !level.empty(); ++depth) {
+    std::vector<page_id_t> next_level;
+    for (page_id_t page_id : level) {
+      if (pinned_pages.size() >= max_pinned) {
+        break;
+      }
+      // Nodes that stay pinned keep their pin
+      Page *page;
+      auto it = pinned_pages_.find(page_id);
+      if (it != pinned_pages_.end()) {
+        page = it->second;
+        pinned_pages_.erase(it);
+      } else {
+        page = buffer_pool_manager_->FetchPage(page_id, partition_);
+        if (page == nullptr) {
+          continue;
+        }
+      }
+      pinned_pages.emplace(page_id, page);
+
+      auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      if (!node->IsLeafPage() && depth + 1 < pinned_levels_) {
+        auto *internal = reinterpret_cast<InternalPage *>(node);
+        for (int i = 0; i < internal->GetSize(); i++) {
+          next_level.push_back(internal->ValueAt(i));
+        }
+      }
+    }
+    level.swap(next_level);
+  }
+
+  for (const auto &[page_id, page] : pinned_pages_) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+  pinned_pages_.swap(pinned_pages);
+  pinned_stale_ = false;
+}
+
+/*
+ * Delete a node page. A page of the pinned top levels cannot be deleted while
+ * pinned, so it is deleted by UnlockUnpinPages() once the pinned levels are
+ * rebuilt.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeleteNode(page_id_t page_id, Transaction *transaction) {
+  if (transaction != nullptr && pinned_pages_.count(page_id) != 0) {
+    pinned_stale_ = true;
+    transaction->AddIntoDeletedPageSet(page_id);
+    return;
+  }
+  DeletePageOrDefer(page_id);
+}
+
+/*
+ * Delete a page that is no longer part of the tree. An iterator hopping to the
+ * next leaf pins it before latching it, so the page may still be pinned; its
+ * deletion is then retried once the pin is dropped.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeletePageOrDefer(page_id_t page_id) {
+  if (buffer_pool_manager_->DeletePage(page_id)) {
+    return;
+  }
+  BUSTUB_METRIC_COUNT("btree.deferred_delete", 1);
+  std::scoped_lock<std::mutex> lock(pending_latch_);
+  pending_deletes_.push_back(page_id);
+  has_pending_deletes_.store(true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RetryPendingDeletes() {
+  if (!has_pending_deletes_.load()) {
+    return;
+  }
+  std::scoped_lock<std::mutex> lock(pending_latch_);
+  auto still_pinned = std::remove_if(pending_deletes_.begin(), pending_deletes_.end(),
+                                     [this](page_id_t page_id) { return buffer_pool_manager_->DeletePage(page_id); });
+  pending_deletes_.erase(still_pinned, pending_deletes_.end());
+  has_pending_deletes_.store(!pending_deletes_.empty());
+}
+
+/*
+ * Pin a node that may already be pinned by this operation: a latched ancestor
+ * in the transaction's page set or a node of the pinned top levels. Those only
+ * get their pin count bumped through Page::Pin(), without a page table lookup
+ * or the buffer pool manager latch; other nodes are fetched as usual.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::PinNode(page_id_t page_id, Transaction *transaction) -> Page * {
+  Page *page = nullptr;
+  auto it = pinned_pages_.find(page_id);
+  if (it != pinned_pages_.end()) {
+    page = it->second;
+  } else if (transaction != nullptr) {
+    auto page_set = transaction->GetPageSet();
+    auto held = std::find_if(page_set->rbegin(), page_set->rend(),
+                             [page_id](Page *p) { return p != nullptr && p->GetPageId() == page_id; });
+    if (held != page_set->rend()) {
+      page = *held;
+    }
+  }
+  if (page == nullptr) {
+    return buffer_pool_manager_->FetchPage(page_id, partition_);
+  }
+  page->Pin();
+  return page;
+}
+
+/*
+ * Release a pin taken by PinNode(). Only the last pin of a page has to go
+ * through the buffer pool manager.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::UnpinNode(Page *page, bool is_dirty) {
+  if (!page->Unpin(is_dirty)) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), is_dirty);
+  }
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -249,6 +528,14 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
+  BUSTUB_METRIC_SCOPED_TIMER("btree.insert_ns");
+  // The write path releases root_latch_ and the latched ancestors through the
+  // transaction's page set, so it always needs one
+  Transaction local_transaction(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local_transaction;
+  }
+
   root_latch_.WLock();
   if (IsEmpty()) {
     StartNewTree(key, value);
@@ -265,7 +552,7 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
   page_id_t new_page_id;
-  auto *page = buffer_pool_manager_->NewPage(&new_page_id);
+  auto *page = NewLeafPage(&new_page_id, INVALID_PAGE_ID);
   if (page == nullptr) {
     throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new page for B+ tree root");
   }
@@ -278,6 +565,9 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
   UpdateRootPageId(1);
 
   buffer_pool_manager_->UnpinPage(new_page_id, true);
+  if (pinned_levels_ > 0) {
+    RefreshPinnedLevels();
+  }
 }
 
 /*
@@ -327,13 +617,116 @@ auto BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
   return true;
 }
 
+/*
+ * Insert a batch of key-value pairs. After a traversal to the leaf of one
+ * pair, the following pairs go straight into that leaf as long as they lie
+ * between the separators bounding it and it does not have to split, so a
+ * sorted batch costs about one traversal per leaf instead of one per pair.
+ * @return the number of pairs inserted, duplicate keys are skipped
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::InsertBatch(const std::vector<std::pair<KeyType, ValueType>> &entries, Transaction *transaction)
+    -> size_t {
+  Transaction local_transaction(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local_transaction;
+  }
+
+  size_t inserted = 0;
+  size_t i = 0;
+  while (i < entries.size()) {
+    root_latch_.WLock();
+    if (IsEmpty()) {
+      StartNewTree(entries[i].first, entries[i].second);
+      root_latch_.WUnlock();
+      inserted++;
+      i++;
+      continue;
+    }
+    root_latch_.WUnlock();
+
+    auto *page = FindLeafPage(entries[i].first, false, Operation::INSERT, transaction);
+    if (page == nullptr) {
+      // The tree became empty in between, start it again
+      continue;
+    }
+    auto *leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+    KeyType lower;
+    KeyType upper;
+    bool has_lower;
+    bool has_upper;
+    LeafBounds(leaf_page->GetPageId(), transaction, &lower, &has_lower, &upper, &has_upper);
+
+    bool is_dirty = false;
+    while (true) {
+      const auto &[key, value] = entries[i++];
+      ValueType existing_value;
+      if (!leaf_page->Lookup(key, &existing_value, comparator_)) {
+        is_dirty = true;
+        inserted++;
+        if (leaf_page->Insert(key, value, comparator_) >= leaf_max_size_) {
+          auto *new_leaf = Split(leaf_page);
+          InsertIntoParent(leaf_page, new_leaf->KeyAt(0), new_leaf, transaction);
+          buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+          break;
+        }
+      }
+      if (i == entries.size()) {
+        break;
+      }
+      const KeyType &next_key = entries[i].first;
+      if ((has_lower && comparator_(next_key, lower) < 0) || (has_upper && comparator_(next_key, upper) >= 0)) {
+        break;
+      }
+    }
+
+    UnlockUnpinPages(transaction);
+    page_id_t leaf_page_id = page->GetPageId();
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(leaf_page_id, is_dirty);
+  }
+  return inserted;
+}
+
+/*
+ * Find the separator keys bounding a leaf in the ancestors that the
+ * transaction's page set holds latched: the leaf may hold keys >= *lower and
+ * < *upper. The leftmost leaf has no lower bound, the rightmost no upper one.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LeafBounds(page_id_t leaf_page_id, Transaction *transaction, KeyType *lower, bool *has_lower,
+                                KeyType *upper, bool *has_upper) {
+  *has_lower = false;
+  *has_upper = false;
+  page_id_t child_page_id = leaf_page_id;
+  auto page_set = transaction->GetPageSet();
+  for (auto it = page_set->rbegin(); it != page_set->rend() && !(*has_lower && *has_upper); ++it) {
+    if (*it == nullptr) {
+      continue;
+    }
+    auto *internal = reinterpret_cast<InternalPage *>((*it)->GetData());
+    int index = internal->ValueIndex(child_page_id);
+    if (!*has_lower && index > 0) {
+      *lower = internal->KeyAt(index);
+      *has_lower = true;
+    }
+    if (!*has_upper && index + 1 < internal->GetSize()) {
+      *upper = internal->KeyAt(index + 1);
+      *has_upper = true;
+    }
+    child_page_id = internal->GetPageId();
+  }
+}
+
 /*
  * Split the leaf page and return the new page
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Split(LeafPage *leaf_page) -> LeafPage * {
+  BUSTUB_METRIC_COUNT("btree.split", 1);
   page_id_t new_page_id;
-  auto *page = buffer_pool_manager_->NewPage(&new_page_id);
+  // Place the new sibling in this tree's extent, or near the page it splits off from
+  auto *page = NewLeafPage(&new_page_id, leaf_page->GetPageId());
   if (page == nullptr) {
     throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new leaf page for split");
   }
@@ -342,6 +735,9 @@ auto BPLUSTREE_TYPE::Split(LeafPage *leaf_page) -> LeafPage * {
   new_leaf->Init(new_page_id, leaf_page->GetParentPageId(), leaf_max_size_);
 
   leaf_page->MoveHalfTo(new_leaf);
+  structure_version_++;
+  // The new sibling belongs to the pinned levels as well
+  pinned_stale_ = pinned_stale_ || pinned_pages_.count(leaf_page->GetPageId()) != 0;
 
   return new_leaf;
 }
@@ -351,8 +747,9 @@ auto BPLUSTREE_TYPE::Split(LeafPage *leaf_page) -> LeafPage * {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Split(InternalPage *internal_page) -> InternalPage * {
+  BUSTUB_METRIC_COUNT("btree.split", 1);
   page_id_t new_page_id;
-  auto *page = buffer_pool_manager_->NewPage(&new_page_id);
+  auto *page = buffer_pool_manager_->NewPage(&new_page_id, internal_page->GetPageId(), partition_);
   if (page == nullptr) {
     throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new internal page for split");
   }
@@ -360,7 +757,8 @@ auto BPLUSTREE_TYPE::Split(InternalPage *internal_page) -> InternalPage * {
   auto *new_internal = reinterpret_cast<InternalPage *>(page->GetData());
   new_internal->Init(new_page_id, internal_page->GetParentPageId(), internal_max_size_);
 
-  internal_page->MoveHalfTo(new_internal, buffer_pool_manager_);
+  internal_page->MoveHalfTo(new_internal, buffer_pool_manager_, partition_);
+  pinned_stale_ = pinned_stale_ || pinned_pages_.count(internal_page->GetPageId()) != 0;
 
   return new_internal;
 }
@@ -375,7 +773,7 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
   // If old_node is root, create a new root
   if (old_node->IsRootPage()) {
     page_id_t new_root_id;
-    auto *page = buffer_pool_manager_->NewPage(&new_root_id);
+    auto *page = buffer_pool_manager_->NewPage(&new_root_id, old_node->GetPageId(), partition_);
     if (page == nullptr) {
       throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new root page");
     }
@@ -389,15 +787,17 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
 
     root_page_id_ = new_root_id;
     UpdateRootPageId(0);
+    // Every node moves one level down
+    pinned_stale_ = pinned_levels_ > 0;
 
     buffer_pool_manager_->UnpinPage(new_root_id, true);
     return;
   }
 
-  // Find parent page - it's already locked in page_set
-  // We need to fetch it to get access (this increases pin count, so we must unpin)
+  // Find parent page - it's already locked and pinned in page_set, so
+  // PinNode() only bumps its pin count (we must still unpin it)
   page_id_t parent_id = old_node->GetParentPageId();
-  auto *parent_page = buffer_pool_manager_->FetchPage(parent_id);
+  auto *parent_page = PinNode(parent_id, transaction);
   auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
 
   new_node->SetParentPageId(parent_id);
@@ -411,8 +811,8 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
     buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
   }
 
-  // Unpin the extra fetch we did (the original pin from FindLeafPage is in page_set)
-  buffer_pool_manager_->UnpinPage(parent_id, true);
+  // Unpin the extra pin we took (the original pin from FindLeafPage is in page_set)
+  UnpinNode(parent_page, true);
 }
 
 /*****************************************************************************
@@ -427,6 +827,12 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
+  BUSTUB_METRIC_SCOPED_TIMER("btree.remove_ns");
+  Transaction local_transaction(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local_transaction;
+  }
+
   auto *page = FindLeafPage(key, false, Operation::DELETE, transaction);
   if (page == nullptr) {
     return;
@@ -453,11 +859,13 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
   if (transaction != nullptr) {
     UnlockUnpinPages(transaction);
   }
+  // Read the id before unpinning: once unpinned the frame may be reused by another page
+  page_id_t leaf_page_id = page->GetPageId();
   page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  buffer_pool_manager_->UnpinPage(leaf_page_id, true);
 
   if (should_delete) {
-    buffer_pool_manager_->DeletePage(leaf_page->GetPageId());
+    DeletePageOrDefer(leaf_page_id);
   }
 }
 
@@ -478,9 +886,10 @@ auto BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) -
     return false;
   }
 
-  // Get parent and sibling
+  // Get parent and sibling; the parent is in page_set, and either may be one
+  // of the pinned top levels
   page_id_t parent_id = node->GetParentPageId();
-  auto *parent_page = buffer_pool_manager_->FetchPage(parent_id);
+  auto *parent_page = PinNode(parent_id, transaction);
   auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
 
   int index = parent->ValueIndex(node->GetPageId());
@@ -488,24 +897,31 @@ auto BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) -
   // Try to borrow from left sibling
   if (index > 0) {
     page_id_t left_sibling_id = parent->ValueAt(index - 1);
-    auto *left_sibling_page = buffer_pool_manager_->FetchPage(left_sibling_id);
+    auto *left_sibling_page = PinNode(left_sibling_id, transaction);
     auto *left_sibling = reinterpret_cast<N *>(left_sibling_page->GetData());
+    // A sibling is not on our path, so readers that passed the parent before
+    // us may still be in it. Other writers wait for the root latch, and
+    // readers never wait for a node while holding its sibling, so latching
+    // it while holding node cannot deadlock
+    left_sibling_page->WLatch();
 
     // Redistribute from left sibling
     if (left_sibling->GetSize() > left_sibling->GetMinSize()) {
       Redistribute(left_sibling, node, parent, index, true);
-      buffer_pool_manager_->UnpinPage(left_sibling_id, true);
-      buffer_pool_manager_->UnpinPage(parent_id, true);
+      left_sibling_page->WUnlatch();
+      UnpinNode(left_sibling_page, true);
+      UnpinNode(parent_page, true);
       return false;
     }
 
     // Coalesce with left sibling
     bool parent_should_delete = Coalesce(left_sibling, node, parent, index, transaction);
-    buffer_pool_manager_->UnpinPage(left_sibling_id, true);
-    buffer_pool_manager_->UnpinPage(parent_id, true);
+    left_sibling_page->WUnlatch();
+    UnpinNode(left_sibling_page, true);
+    UnpinNode(parent_page, true);
 
     if (parent_should_delete) {
-      buffer_pool_manager_->DeletePage(parent_id);
+      DeleteNode(parent_id, transaction);
     }
     return true;  // node should be deleted
   }
@@ -513,34 +929,37 @@ auto BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) -
   // Try to borrow from right sibling
   if (index < parent->GetSize() - 1) {
     page_id_t right_sibling_id = parent->ValueAt(index + 1);
-    auto *right_sibling_page = buffer_pool_manager_->FetchPage(right_sibling_id);
+    auto *right_sibling_page = PinNode(right_sibling_id, transaction);
     auto *right_sibling = reinterpret_cast<N *>(right_sibling_page->GetData());
+    right_sibling_page->WLatch();
 
     // Redistribute from right sibling
     if (right_sibling->GetSize() > right_sibling->GetMinSize()) {
       Redistribute(right_sibling, node, parent, index, false);
-      buffer_pool_manager_->UnpinPage(right_sibling_id, true);
-      buffer_pool_manager_->UnpinPage(parent_id, true);
+      right_sibling_page->WUnlatch();
+      UnpinNode(right_sibling_page, true);
+      UnpinNode(parent_page, true);
       return false;
     }
 
     // Coalesce with right sibling (move right sibling into node)
     bool parent_should_delete = Coalesce(node, right_sibling, parent, index + 1, transaction);
 
-    buffer_pool_manager_->UnpinPage(parent_id, true);
+    UnpinNode(parent_page, true);
 
     if (parent_should_delete) {
-      buffer_pool_manager_->DeletePage(parent_id);
+      DeleteNode(parent_id, transaction);
     }
 
     // Delete right sibling
-    buffer_pool_manager_->UnpinPage(right_sibling_id, true);
-    buffer_pool_manager_->DeletePage(right_sibling_id);
+    right_sibling_page->WUnlatch();
+    UnpinNode(right_sibling_page, true);
+    DeleteNode(right_sibling_id, transaction);
 
     return false;  // node should not be deleted
   }
 
-  buffer_pool_manager_->UnpinPage(parent_id, false);
+  UnpinNode(parent_page, false);
   return false;
 }
 
@@ -554,6 +973,7 @@ auto BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) -> bool {
   if (old_root_node->IsLeafPage() && old_root_node->GetSize() == 0) {
     root_page_id_ = INVALID_PAGE_ID;
     UpdateRootPageId(0);
+    pinned_stale_ = pinned_levels_ > 0;
     return true;
   }
 
@@ -562,12 +982,14 @@ auto BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) -> bool {
     auto *old_root = reinterpret_cast<InternalPage *>(old_root_node);
     page_id_t new_root_id = old_root->ValueAt(0);
 
-    auto *new_root_page = buffer_pool_manager_->FetchPage(new_root_id);
+    auto *new_root_page = buffer_pool_manager_->FetchPage(new_root_id, partition_);
     auto *new_root = reinterpret_cast<BPlusTreePage *>(new_root_page->GetData());
     new_root->SetParentPageId(INVALID_PAGE_ID);
 
     root_page_id_ = new_root_id;
     UpdateRootPageId(0);
+    // Every node moves one level up
+    pinned_stale_ = pinned_levels_ > 0;
 
     buffer_pool_manager_->UnpinPage(new_root_id, true);
     return true;
@@ -583,9 +1005,11 @@ auto BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) -> bool {
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index, bool from_left) {
+  BUSTUB_METRIC_COUNT("btree.redistribute", 1);
   if (node->IsLeafPage()) {
     auto *leaf_node = reinterpret_cast<LeafPage *>(node);
     auto *neighbor_leaf = reinterpret_cast<LeafPage *>(neighbor_node);
+    structure_version_++;
 
     if (from_left) {
       neighbor_leaf->MoveLastToFrontOf(leaf_node);
@@ -600,11 +1024,11 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, InternalPage *paren
 
     if (from_left) {
       KeyType middle_key = parent->KeyAt(index);
-      neighbor_internal->MoveLastToFrontOf(internal_node, middle_key, buffer_pool_manager_);
+      neighbor_internal->MoveLastToFrontOf(internal_node, middle_key, buffer_pool_manager_, partition_);
       parent->SetKeyAt(index, internal_node->KeyAt(0));
     } else {
       KeyType middle_key = parent->KeyAt(index + 1);
-      neighbor_internal->MoveFirstToEndOf(internal_node, middle_key, buffer_pool_manager_);
+      neighbor_internal->MoveFirstToEndOf(internal_node, middle_key, buffer_pool_manager_, partition_);
       parent->SetKeyAt(index + 1, neighbor_internal->KeyAt(0));
     }
   }
@@ -620,20 +1044,23 @@ template <typename N>
 auto BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node, InternalPage *parent, int index, Transaction *transaction)
     -> bool {
   // node is at index, neighbor_node is at index-1 (left sibling)
+  BUSTUB_METRIC_COUNT("btree.merge", 1);
   KeyType middle_key = parent->KeyAt(index);
 
   if (node->IsLeafPage()) {
     auto *leaf_node = reinterpret_cast<LeafPage *>(node);
     auto *neighbor_leaf = reinterpret_cast<LeafPage *>(neighbor_node);
     leaf_node->MoveAllTo(neighbor_leaf);
+    structure_version_++;
   } else {
     auto *internal_node = reinterpret_cast<InternalPage *>(node);
     auto *neighbor_internal = reinterpret_cast<InternalPage *>(neighbor_node);
-    internal_node->MoveAllTo(neighbor_internal, middle_key, buffer_pool_manager_);
+    internal_node->MoveAllTo(neighbor_internal, middle_key, buffer_pool_manager_, partition_);
   }
 
   // Remove the entry from parent
   parent->Remove(index);
+  pinned_stale_ = pinned_stale_ || pinned_pages_.count(node->GetPageId()) != 0;
 
   // Check if parent needs to coalesce or redistribute
   return CoalesceOrRedistribute(parent, transaction);
@@ -649,41 +1076,9 @@ auto BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node, InternalPage *parent, i
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
-  root_latch_.RLock();
-  if (IsEmpty()) {
-    root_latch_.RUnlock();
-    return INDEXITERATOR_TYPE(nullptr, 0, buffer_pool_manager_);
-  }
-
-  // Find the leftmost leaf page
-  auto *page = buffer_pool_manager_->FetchPage(root_page_id_);
-  if (page == nullptr) {
-    root_latch_.RUnlock();
-    return INDEXITERATOR_TYPE(nullptr, 0, buffer_pool_manager_);
-  }
-  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
-  page->RLatch();
-  root_latch_.RUnlock();
-
-  while (!node->IsLeafPage()) {
-    auto *internal = reinterpret_cast<InternalPage *>(node);
-    page_id_t child_page_id = internal->ValueAt(0);
-    auto *child_page = buffer_pool_manager_->FetchPage(child_page_id);
-    if (child_page == nullptr) {
-      page->RUnlatch();
-      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
-      return INDEXITERATOR_TYPE(nullptr, 0, buffer_pool_manager_);
-    }
-    child_page->RLatch();
-    page->RUnlatch();
-    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
-    page = child_page;
-    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
-  }
-
-  // Release the latch but keep the page pinned for the iterator
-  page->RUnlatch();
-  return INDEXITERATOR_TYPE(reinterpret_cast<LeafPage *>(node), 0, buffer_pool_manager_);
+  // The iterator takes over the latch and the pin of the leaf
+  auto *page = FindLeafPage(KeyType(), true, Operation::SEARCH, nullptr);
+  return INDEXITERATOR_TYPE(this, page, 0, buffer_pool_manager_);
 }
 
 /*
@@ -693,42 +1088,15 @@ auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
-  root_latch_.RLock();
-  if (IsEmpty()) {
-    root_latch_.RUnlock();
-    return INDEXITERATOR_TYPE(nullptr, 0, buffer_pool_manager_);
-  }
-
-  auto *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  auto *page = FindLeafPage(key, false, Operation::SEARCH, nullptr);
   if (page == nullptr) {
-    root_latch_.RUnlock();
-    return INDEXITERATOR_TYPE(nullptr, 0, buffer_pool_manager_);
+    return INDEXITERATOR_TYPE(this, nullptr, 0, buffer_pool_manager_);
   }
-  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
-  page->RLatch();
-  root_latch_.RUnlock();
 
-  while (!node->IsLeafPage()) {
-    auto *internal = reinterpret_cast<InternalPage *>(node);
-    page_id_t child_page_id = internal->Lookup(key, comparator_);
-    auto *child_page = buffer_pool_manager_->FetchPage(child_page_id);
-    if (child_page == nullptr) {
-      page->RUnlatch();
-      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
-      return INDEXITERATOR_TYPE(nullptr, 0, buffer_pool_manager_);
-    }
-    child_page->RLatch();
-    page->RUnlatch();
-    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
-    page = child_page;
-    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
-  }
-
-  auto *leaf_page = reinterpret_cast<LeafPage *>(node);
+  auto *leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
   int index = leaf_page->KeyIndex(key, comparator_);
-  // Release the latch but keep the page pinned for the iterator
-  page->RUnlatch();
-  return INDEXITERATOR_TYPE(leaf_page, index, buffer_pool_manager_);
+  // The iterator takes over the latch and the pin of the leaf
+  return INDEXITERATOR_TYPE(this, page, index, buffer_pool_manager_, &key);
 }
 
 /*
@@ -737,7 +1105,9 @@ auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(nullptr, 0, buffer_pool_manager_); }
+auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE {
+  return INDEXITERATOR_TYPE(this, nullptr, 0, buffer_pool_manager_);
+}
 
 /**
  * @return Page id of the root of this tree
@@ -769,41 +1139,694 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
+/*
+ * Look up this index's record in the header page and adopt the root page id
+ * stored there, e.g. to open an existing index file through a read-only
+ * MmapBufferPoolManager.
+ * @return : false if the header page has no record for this index
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LoadRootPageId() -> bool {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return false;
+  }
+  page_id_t root_page_id;
+  bool found = header_page->GetRootId(index_name_, &root_page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (!found) {
+    return false;
+  }
+  root_latch_.WLock();
+  root_page_id_ = root_page_id;
+  root_latch_.WUnlock();
+  return true;
+}
+
 /*
  * This method is used for test only
- * Read data from file and insert one by one
+ * Read keys from a text file and insert them
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertFromFile(const std::string &file_name, Transaction *transaction) {
-  int64_t key;
-  std::ifstream input(file_name);
-  while (input) {
-    input >> key;
+  InsertFromFile(file_name, KeyFileFormat::TEXT, true, transaction);
+}
 
-    KeyType index_key;
-    index_key.SetFromInteger(key);
-    RID rid(key);
-    Insert(index_key, rid, transaction);
+/*
+ * Read keys from a file in batches of BPLUSTREE_LOAD_BATCH_SIZE, sort each
+ * batch and insert it with InsertBatch(). If pipelined, a reader thread
+ * parses and sorts the next batches (up to BPLUSTREE_LOAD_QUEUE_DEPTH ahead)
+ * while this thread inserts.
+ * @return the number of keys inserted
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::InsertFromFile(const std::string &file_name, KeyFileFormat format, bool pipelined,
+                                    Transaction *transaction) -> size_t {
+  using Batch = std::vector<std::pair<KeyType, ValueType>>;
+  KeyFileReader reader(file_name, format);
+  auto start = std::chrono::steady_clock::now();
+
+  auto read_batch = [&reader](Batch *batch) -> bool {
+    std::vector<int64_t> keys;
+    if (!reader.ReadBatch(BPLUSTREE_LOAD_BATCH_SIZE, &keys)) {
+      return false;
+    }
+    std::sort(keys.begin(), keys.end());
+    batch->clear();
+    batch->reserve(keys.size());
+    for (int64_t key : keys) {
+      KeyType index_key;
+      index_key.SetFromInteger(key);
+      RID rid(key);
+      batch->emplace_back(index_key, rid);
+    }
+    return true;
+  };
+
+  size_t rows = 0;
+  size_t inserted = 0;
+  if (!pipelined) {
+    Batch batch;
+    while (read_batch(&batch)) {
+      rows += batch.size();
+      inserted += InsertBatch(batch, transaction);
+    }
+  } else {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Batch> ready;
+    bool done = false;
+    bool stop = false;
+    // a read or parse error of the reader thread, rethrown here once the batches before it are inserted
+    std::exception_ptr read_error;
+    std::thread reader_thread([&] {
+      try {
+        Batch batch;
+        while (read_batch(&batch)) {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&] { return stop || ready.size() < BPLUSTREE_LOAD_QUEUE_DEPTH; });
+          if (stop) {
+            break;
+          }
+          ready.push_back(std::move(batch));
+          cv.notify_all();
+        }
+      } catch (...) {
+        read_error = std::current_exception();
+      }
+      std::scoped_lock<std::mutex> lock(mutex);
+      done = true;
+      cv.notify_all();
+    });
+
+    try {
+      while (true) {
+        Batch batch;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&] { return done || !ready.empty(); });
+          if (ready.empty()) {
+            break;
+          }
+          batch = std::move(ready.front());
+          ready.pop_front();
+          cv.notify_all();
+        }
+        rows += batch.size();
+        inserted += InsertBatch(batch, transaction);
+      }
+    } catch (...) {
+      {
+        std::scoped_lock<std::mutex> lock(mutex);
+        stop = true;
+        cv.notify_all();
+      }
+      reader_thread.join();
+      throw;
+    }
+    reader_thread.join();
+    if (read_error != nullptr) {
+      std::rethrow_exception(read_error);
+    }
   }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  LOG_INFO("loaded %zu keys (%zu new) from %s in %.3fs, %.0f keys/s", rows, inserted, file_name.c_str(),
+           elapsed.count(), elapsed.count() > 0 ? static_cast<double>(rows) / elapsed.count() : 0.0);
+  return inserted;
 }
+
 /*
  * This method is used for test only
- * Read data from file and remove one by one
+ * Read keys from a text file and remove them one by one
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::RemoveFromFile(const std::string &file_name, Transaction *transaction) {
-  int64_t key;
-  std::ifstream input(file_name);
-  while (input) {
-    input >> key;
-    KeyType index_key;
-    index_key.SetFromInteger(key);
-    Remove(index_key, transaction);
+  KeyFileReader reader(file_name, KeyFileFormat::TEXT);
+  std::vector<int64_t> keys;
+  while (reader.ReadBatch(BPLUSTREE_LOAD_BATCH_SIZE, &keys)) {
+    for (int64_t key : keys) {
+      KeyType index_key;
+      index_key.SetFromInteger(key);
+      Remove(index_key, transaction);
+    }
+  }
+}
+
+/*
+ * Write all entries to a snapshot file (see IndexSnapshotWriter) by walking
+ * the leaf chain. Writers hold root_latch_ in write mode for their whole
+ * operation, so the walk holds it in read mode, but only while it copies up
+ * to BPLUSTREE_EXPORT_CHUNK_SIZE entries; they are encoded and written after
+ * the latch is released, and the next chunk starts at the leaf holding the
+ * key after the last one copied. Writers thus wait for a chunk copy at most,
+ * not for the file I/O, and the snapshot is consistent within each chunk
+ * only: entries inserted or removed between two chunks may or may not be in
+ * it. Every key is written at most once and in key order, as
+ * ImportSnapshot() requires.
+ * @return the number of entries written
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::ExportSnapshot(const std::string &file_name) -> size_t {
+  IndexSnapshotWriter writer(file_name, sizeof(KeyType), sizeof(ValueType));
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<MappingType> chunk;
+  chunk.reserve(BPLUSTREE_EXPORT_CHUNK_SIZE);
+  KeyType last_key;
+  bool has_last_key = false;
+  bool full = true;
+  while (full) {
+    chunk.clear();
+    full = false;
+    root_latch_.RLock();
+    page_id_t page_id = root_page_id_;
+    while (page_id != INVALID_PAGE_ID) {
+      bool pinned;
+      auto *page = FetchNode(page_id, &pinned);
+      if (page == nullptr) {
+        root_latch_.RUnlock();
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot fetch page for snapshot export");
+      }
+      page->RLatch();
+      auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      page_id_t next_page_id;
+      if (node->IsLeafPage()) {
+        auto *leaf = reinterpret_cast<LeafPage *>(node);
+        for (int i = 0; i < leaf->GetSize() && !full; i++) {
+          const auto &item = leaf->GetItem(i);
+          if (has_last_key && comparator_(item.first, last_key) <= 0) {
+            continue;
+          }
+          chunk.push_back(item);
+          full = chunk.size() == BPLUSTREE_EXPORT_CHUNK_SIZE;
+        }
+        next_page_id = full ? INVALID_PAGE_ID : leaf->GetNextPageId();
+      } else {
+        // Descend to the leftmost leaf, or to the one that holds the keys after the last chunk
+        auto *internal = reinterpret_cast<InternalPage *>(node);
+        next_page_id = has_last_key ? internal->Lookup(last_key, comparator_) : internal->ValueAt(0);
+      }
+      page->RUnlatch();
+      if (!pinned) {
+        buffer_pool_manager_->UnpinPage(page_id, false);
+      }
+      page_id = next_page_id;
+    }
+    root_latch_.RUnlock();
+
+    for (const auto &item : chunk) {
+      writer.Append(reinterpret_cast<const char *>(&item.first), reinterpret_cast<const char *>(&item.second));
+    }
+    if (!chunk.empty()) {
+      last_key = chunk.back().first;
+      has_last_key = true;
+    }
+  }
+
+  writer.Finish();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  LOG_INFO("exported %zu entries of %s to %s in %.3fs", static_cast<size_t>(writer.EntryCount()),
+           index_name_.c_str(), file_name.c_str(), elapsed.count());
+  return writer.EntryCount();
+}
+
+/*
+ * Build the tree from a snapshot file written by ExportSnapshot(), bottom-up
+ * instead of by inserting the entries one at a time (see BuildFromSnapshot()).
+ * @return the number of entries loaded
+ * @throws Exception if the tree is not empty, or the snapshot is unreadable or
+ * not sorted; the pages built so far are deleted again then
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::ImportSnapshot(const std::string &file_name) -> size_t {
+  IndexSnapshotReader reader(file_name, sizeof(KeyType), sizeof(ValueType));
+  auto start = std::chrono::steady_clock::now();
+
+  root_latch_.WLock();
+  if (!IsEmpty()) {
+    root_latch_.WUnlock();
+    throw Exception("can't import a snapshot into the non-empty index " + index_name_);
+  }
+  if (reader.EntryCount() == 0) {
+    root_latch_.WUnlock();
+    return 0;
   }
+
+  std::vector<page_id_t> built;
+  page_id_t root_page_id;
+  try {
+    root_page_id = BuildFromSnapshot(&reader, &built);
+  } catch (...) {
+    for (page_id_t page_id : built) {
+      buffer_pool_manager_->DeletePage(page_id);
+    }
+    root_latch_.WUnlock();
+    throw;
+  }
+
+  root_page_id_ = root_page_id;
+  UpdateRootPageId(1);
+  if (pinned_levels_ > 0) {
+    RefreshPinnedLevels();
+  }
+  root_latch_.WUnlock();
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  LOG_INFO("imported %zu entries into %s from %s in %.3fs", static_cast<size_t>(reader.EntryCount()),
+           index_name_.c_str(), file_name.c_str(), elapsed.count());
+  return reader.EntryCount();
+}
+
+/*
+ * Build the nodes of a tree holding the entries of a snapshot, in key order.
+ * Leaves are filled to leaf_max_size_ - 1 entries and internal nodes to
+ * internal_max_size_ - 1 children, just below the split point; knowing the
+ * entry count up front, each level spreads its entries evenly over its nodes,
+ * so none of them ends up below its minimum size. The internal nodes right
+ * above the leaves are created ahead of their leaves, so that every leaf is
+ * written out complete and never fetched again; the nodes of the higher
+ * levels are few and get their parent set by a second fetch.
+ * Since the size of every level is known, its pages are created in chunks of
+ * BPLUSTREE_BUILD_CHUNK_SIZE with NewPages(), which takes the buffer pool
+ * manager latch once per chunk and gives each chunk contiguous page ids.
+ * Caller must hold root_latch_ in write mode.
+ * @param built receives the id of every page created, also when this throws
+ * @return the page id of the new root
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BuildFromSnapshot(IndexSnapshotReader *reader, std::vector<page_id_t> *built) -> page_id_t {
+  // Size of the index-th of nodes nodes sharing total entries or children
+  auto share = [](uint64_t total, uint64_t nodes, uint64_t index) {
+    return static_cast<int>(total / nodes + (index < total % nodes ? 1 : 0));
+  };
+  const uint64_t entries = reader->EntryCount();
+  const uint64_t leaf_fill = leaf_max_size_ - 1;
+  const uint64_t internal_fill = internal_max_size_ - 1;
+  const uint64_t leaves = (entries + leaf_fill - 1) / leaf_fill;
+  const uint64_t parents = leaves > 1 ? (leaves + internal_fill - 1) / internal_fill : 0;
+  // Pages of a chunk not handed out yet stay pinned, so a chunk takes at most an eighth of the pool
+  const size_t chunk_size =
+      std::max<size_t>(std::min(BPLUSTREE_BUILD_CHUNK_SIZE, buffer_pool_manager_->GetPoolSize() / 8), 1);
+
+  // Hands out the new pages of one level, creating them chunk by chunk
+  struct LevelPages {
+    BufferPoolManager *bpm_;
+    partition_id_t partition_;
+    size_t chunk_size_;
+    // nodes of the level whose pages are not created yet
+    uint64_t left_;
+    std::vector<page_id_t> page_ids_{};
+    std::vector<Page *> pages_{};
+    size_t next_{0};
+
+    auto Next(std::vector<page_id_t> *built) -> Page * {
+      if (next_ == pages_.size()) {
+        size_t n = std::min<uint64_t>(left_, chunk_size_);
+        page_ids_.resize(n);
+        pages_.resize(n);
+        next_ = 0;
+        if (n == 0 || !bpm_->NewPages(n, page_ids_.data(), pages_.data(), partition_)) {
+          pages_.clear();
+          return nullptr;
+        }
+        left_ -= n;
+        built->insert(built->end(), page_ids_.begin(), page_ids_.end());
+      }
+      return pages_[next_++];
+    }
+
+    // Unpin the pages of the chunk that were not handed out, after an error
+    void Release() {
+      for (; next_ < pages_.size(); next_++) {
+        bpm_->UnpinPage(page_ids_[next_], false);
+      }
+    }
+  };
+  LevelPages leaf_pages{buffer_pool_manager_, partition_, chunk_size, leaves};
+  LevelPages parent_pages{buffer_pool_manager_, partition_, chunk_size, parents};
+
+  // (first key, page id) of each node of the last level built
+  std::vector<std::pair<KeyType, page_id_t>> level;
+  std::vector<MappingType> items(leaf_fill);
+  KeyType last_key;
+  Page *prev_page = nullptr;
+  Page *parent_page = nullptr;
+  int parent_left = 0;
+  uint64_t parent_index = 0;
+  auto release = [&]() {
+    leaf_pages.Release();
+    parent_pages.Release();
+    if (prev_page != nullptr) {
+      buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+      prev_page = nullptr;
+    }
+    if (parent_page != nullptr) {
+      buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+      parent_page = nullptr;
+    }
+  };
+
+  try {
+    for (uint64_t i = 0; i < leaves; i++) {
+      // Read and check the leaf's entries before anything else gets pinned
+      int size = share(entries, leaves, i);
+      for (int j = 0; j < size; j++) {
+        auto &item = items[j];
+        if (!reader->Next(reinterpret_cast<char *>(&item.first), reinterpret_cast<char *>(&item.second))) {
+          throw Exception("snapshot holds fewer entries than its header says");
+        }
+        if ((i > 0 || j > 0) && comparator_(last_key, item.first) >= 0) {
+          throw Exception("snapshot entries are not sorted by key");
+        }
+        last_key = item.first;
+      }
+
+      if (parents > 0 && parent_left == 0) {
+        if (parent_page != nullptr) {
+          buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+        }
+        parent_page = parent_pages.Next(built);
+        if (parent_page == nullptr) {
+          throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new internal page for snapshot import");
+        }
+        page_id_t parent_id = parent_page->GetPageId();
+        reinterpret_cast<InternalPage *>(parent_page->GetData())->Init(parent_id, INVALID_PAGE_ID, internal_max_size_);
+        parent_left = share(leaves, parents, parent_index++);
+        level.emplace_back(items[0].first, parent_id);
+      }
+
+      auto *page = leaf_pages.Next(built);
+      if (page == nullptr) {
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new leaf page for snapshot import");
+      }
+      page_id_t leaf_page_id = page->GetPageId();
+      auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+      leaf->Init(leaf_page_id, parent_page != nullptr ? parent_page->GetPageId() : INVALID_PAGE_ID, leaf_max_size_);
+      for (int j = 0; j < size; j++) {
+        leaf->SetKeyAt(j, items[j].first);
+        leaf->SetValueAt(j, items[j].second);
+      }
+      leaf->SetSize(size);
+
+      if (prev_page != nullptr) {
+        reinterpret_cast<LeafPage *>(prev_page->GetData())->SetNextPageId(leaf_page_id);
+        buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+      }
+      prev_page = page;
+
+      if (parent_page != nullptr) {
+        auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+        int index = parent->GetSize();
+        parent->SetKeyAt(index, items[0].first);
+        parent->SetValueAt(index, leaf_page_id);
+        parent->IncreaseSize(1);
+        parent_left--;
+      } else {
+        level.emplace_back(items[0].first, leaf_page_id);
+      }
+    }
+  } catch (...) {
+    release();
+    throw;
+  }
+  release();
+
+  while (level.size() > 1) {
+    const uint64_t nodes = (level.size() + internal_fill - 1) / internal_fill;
+    std::vector<std::pair<KeyType, page_id_t>> upper;
+    LevelPages level_pages{buffer_pool_manager_, partition_, chunk_size, nodes};
+    size_t child = 0;
+    for (uint64_t i = 0; i < nodes; i++) {
+      auto *page = level_pages.Next(built);
+      if (page == nullptr) {
+        level_pages.Release();
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot allocate new internal page for snapshot import");
+      }
+      page_id_t page_id = page->GetPageId();
+      auto *node = reinterpret_cast<InternalPage *>(page->GetData());
+      node->Init(page_id, INVALID_PAGE_ID, internal_max_size_);
+      upper.emplace_back(level[child].first, page_id);
+
+      int size = share(level.size(), nodes, i);
+      for (int j = 0; j < size; j++, child++) {
+        node->SetKeyAt(j, level[child].first);
+        node->SetValueAt(j, level[child].second);
+        auto *child_page = buffer_pool_manager_->FetchPage(level[child].second, partition_);
+        if (child_page == nullptr) {
+          buffer_pool_manager_->UnpinPage(page_id, true);
+          level_pages.Release();
+          throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot fetch child page for snapshot import");
+        }
+        reinterpret_cast<BPlusTreePage *>(child_page->GetData())->SetParentPageId(page_id);
+        buffer_pool_manager_->UnpinPage(level[child].second, true);
+      }
+      node->SetSize(size);
+      buffer_pool_manager_->UnpinPage(page_id, true);
+    }
+    level.swap(upper);
+  }
+  return level[0].second;
+}
+
+/*
+ * Check the structure of the tree: every node carries the page id, parent
+ * and max size it should, holds between its min size and max size - 1
+ * entries, and its keys are strictly increasing and lie between the
+ * separators its parent has around it; all leaves are at the same depth and
+ * their next page ids chain them in key order.
+ * Writers hold root_latch_ in write mode for their whole operation, so
+ * holding it in read mode keeps them off while readers go on. A walk pins
+ * only the path from the root of its subtree down to the current node, i.e.
+ * at most height + 1 pages, so the tree can be much larger than the buffer
+ * pool. With threads > 1 the subtrees of the root are walked in parallel and
+ * their leaf chains stitched together afterwards.
+ * @return false if a violation was found, which is described in error
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::Verify(std::string *error, size_t threads) -> bool {
+  struct Subtree {
+    page_id_t page_id_;
+    page_id_t parent_id_;
+    int depth_;
+    KeyType lower_;
+    bool has_lower_;
+    KeyType upper_;
+    bool has_upper_;
+  };
+
+  root_latch_.RLock();
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return true;
+  }
+
+  std::vector<Subtree> subtrees;
+  std::vector<VerifySummary> summaries;
+  if (threads > 1) {
+    auto *page = buffer_pool_manager_->FetchPage(root_page_id_, partition_);
+    if (page == nullptr) {
+      root_latch_.RUnlock();
+      if (error != nullptr) {
+        *error = "can't fetch root page " + std::to_string(root_page_id_);
+      }
+      return false;
+    }
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (!node->IsLeafPage()) {
+      summaries.emplace_back();
+      if (!CheckNode(node, root_page_id_, INVALID_PAGE_ID, KeyType(), false, KeyType(), false,
+                     &summaries.back().error_)) {
+        buffer_pool_manager_->UnpinPage(root_page_id_, false);
+        root_latch_.RUnlock();
+        if (error != nullptr) {
+          *error = summaries.back().error_;
+        }
+        return false;
+      }
+      summaries.clear();
+      auto *root = reinterpret_cast<InternalPage *>(node);
+      for (int i = 0; i < root->GetSize(); i++) {
+        subtrees.push_back({root->ValueAt(i), root_page_id_, 1, i > 0 ? root->KeyAt(i) : KeyType(), i > 0,
+                            i + 1 < root->GetSize() ? root->KeyAt(i + 1) : KeyType(), i + 1 < root->GetSize()});
+      }
+    }
+    buffer_pool_manager_->UnpinPage(root_page_id_, false);
+  }
+  if (subtrees.empty()) {
+    subtrees.push_back({root_page_id_, INVALID_PAGE_ID, 0, KeyType(), false, KeyType(), false});
+  }
+
+  summaries.resize(subtrees.size());
+  auto verify = [&](size_t i) {
+    const auto &subtree = subtrees[i];
+    VerifySubtree(subtree.page_id_, subtree.parent_id_, subtree.depth_, subtree.lower_, subtree.has_lower_,
+                  subtree.upper_, subtree.has_upper_, &summaries[i]);
+  };
+  if (threads <= 1 || subtrees.size() == 1) {
+    verify(0);
+  } else {
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < std::min(threads, subtrees.size()); t++) {
+      workers.emplace_back([&] {
+        for (size_t i = next++; i < subtrees.size(); i = next++) {
+          verify(i);
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+  root_latch_.RUnlock();
+
+  // Stitch the subtrees together: same leaf depth, one leaf chain
+  std::string violation;
+  for (size_t i = 0; i < summaries.size() && violation.empty(); i++) {
+    const auto &summary = summaries[i];
+    if (!summary.error_.empty()) {
+      violation = summary.error_;
+    } else if (summary.leaf_depth_ != summaries[0].leaf_depth_) {
+      violation = "leaf " + std::to_string(summary.first_leaf_) + " is at depth " +
+                  std::to_string(summary.leaf_depth_) + ", leaf " + std::to_string(summaries[0].first_leaf_) +
+                  " at depth " + std::to_string(summaries[0].leaf_depth_);
+    } else if (i > 0 && summaries[i - 1].last_next_ != summary.first_leaf_) {
+      violation = "leaf " + std::to_string(summaries[i - 1].last_leaf_) + " links to page " +
+                  std::to_string(summaries[i - 1].last_next_) + " instead of leaf " +
+                  std::to_string(summary.first_leaf_);
+    }
+  }
+  if (violation.empty() && summaries.back().last_next_ != INVALID_PAGE_ID) {
+    violation = "last leaf " + std::to_string(summaries.back().last_leaf_) + " links to page " +
+                std::to_string(summaries.back().last_next_);
+  }
+  if (!violation.empty() && error != nullptr) {
+    *error = violation;
+  }
+  return violation.empty();
+}
+
+/*
+ * Check the invariants of a single node, see Verify(). lower and upper are
+ * the separators around it in its parent, if it has them.
+ * @return false if one is violated, which is described in error
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::CheckNode(BPlusTreePage *node, page_id_t page_id, page_id_t parent_id, const KeyType &lower,
+                               bool has_lower, const KeyType &upper, bool has_upper, std::string *error) const
+    -> bool {
+  auto fail = [&](const std::string &what) {
+    *error = "page " + std::to_string(page_id) + ": " + what;
+    return false;
+  };
+  if (node->GetPageId() != page_id) {
+    return fail("holds page id " + std::to_string(node->GetPageId()));
+  }
+  if (node->GetParentPageId() != parent_id) {
+    return fail("has parent " + std::to_string(node->GetParentPageId()) + ", expected " + std::to_string(parent_id));
+  }
+  const int max_size = node->IsLeafPage() ? leaf_max_size_ : internal_max_size_;
+  if (node->GetMaxSize() != max_size) {
+    return fail("has max size " + std::to_string(node->GetMaxSize()) + ", expected " + std::to_string(max_size));
+  }
+  // Nodes split as soon as they reach their max size
+  if (node->GetSize() < node->GetMinSize() || node->GetSize() >= max_size) {
+    return fail("has size " + std::to_string(node->GetSize()) + ", expected " + std::to_string(node->GetMinSize()) +
+                " to " + std::to_string(max_size - 1));
+  }
+
+  // The first key of an internal node is unused
+  const int first = node->IsLeafPage() ? 0 : 1;
+  auto key_at = [node](int index) {
+    return node->IsLeafPage() ? reinterpret_cast<LeafPage *>(node)->KeyAt(index)
+                              : reinterpret_cast<InternalPage *>(node)->KeyAt(index);
+  };
+  for (int i = first; i < node->GetSize(); i++) {
+    KeyType key = key_at(i);
+    if (i > first && comparator_(key_at(i - 1), key) >= 0) {
+      return fail("key " + std::to_string(i) + " is not greater than key " + std::to_string(i - 1));
+    }
+    if ((has_lower && comparator_(key, lower) < 0) || (has_upper && comparator_(key, upper) >= 0)) {
+      return fail("key " + std::to_string(i) + " lies outside the separators of parent " + std::to_string(parent_id));
+    }
+  }
+  return true;
+}
+
+/*
+ * Check a subtree depth-first, see Verify(), adding its leaves to summary.
+ * Only the path from the subtree root to the current node is pinned.
+ * @return false at the first violation, which is described in summary
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::VerifySubtree(page_id_t page_id, page_id_t parent_id, int depth, const KeyType &lower,
+                                   bool has_lower, const KeyType &upper, bool has_upper,
+                                   VerifySummary *summary) const -> bool {
+  auto *page = buffer_pool_manager_->FetchPage(page_id, partition_);
+  if (page == nullptr) {
+    summary->error_ = "can't fetch page " + std::to_string(page_id);
+    return false;
+  }
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  bool ok = CheckNode(node, page_id, parent_id, lower, has_lower, upper, has_upper, &summary->error_);
+
+  if (ok && node->IsLeafPage()) {
+    auto *leaf = reinterpret_cast<LeafPage *>(node);
+    if (summary->leaf_depth_ != -1 && summary->leaf_depth_ != depth) {
+      summary->error_ = "leaf " + std::to_string(page_id) + " is at depth " + std::to_string(depth) + ", leaf " +
+                        std::to_string(summary->first_leaf_) + " at depth " + std::to_string(summary->leaf_depth_);
+      ok = false;
+    } else if (summary->last_leaf_ != INVALID_PAGE_ID && summary->last_next_ != page_id) {
+      summary->error_ = "leaf " + std::to_string(summary->last_leaf_) + " links to page " +
+                        std::to_string(summary->last_next_) + " instead of leaf " + std::to_string(page_id);
+      ok = false;
+    } else {
+      if (summary->first_leaf_ == INVALID_PAGE_ID) {
+        summary->first_leaf_ = page_id;
+        summary->leaf_depth_ = depth;
+      }
+      summary->last_leaf_ = page_id;
+      summary->last_next_ = leaf->GetNextPageId();
+      summary->entries_ += leaf->GetSize();
+    }
+  } else if (ok) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    const int size = internal->GetSize();
+    for (int i = 0; ok && i < size; i++) {
+      ok = VerifySubtree(internal->ValueAt(i), page_id, depth + 1, i > 0 ? internal->KeyAt(i) : lower,
+                         i > 0 || has_lower, i + 1 < size ? internal->KeyAt(i + 1) : upper, i + 1 < size || has_upper,
+                         summary);
+    }
+  }
+
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return ok;
 }
 
 /**
- * This method is used for debug only, You don't need to modify
+ * Draw the tree as Graphviz, see Dump(). bpm must be the tree's own buffer
+ * pool manager.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Draw(BufferPoolManager *bpm, const std::string &outf) {
@@ -811,11 +1834,36 @@ void BPLUSTREE_TYPE::Draw(BufferPoolManager *bpm, const std::string &outf) {
     LOG_WARN("Draw an empty tree");
     return;
   }
+  Dump(outf, TreeDumpFormat::GRAPHVIZ);
+}
+
+/*
+ * Write the tree to a file, as a Graphviz graph or as one JSON object per
+ * node with its children nested in it. Writers are held off for the dump by
+ * holding root_latch_ in read mode. Nodes are written depth-first and only the
+ * path from the root down to the current node is pinned, so the tree can be
+ * much larger than the buffer pool; pages that can't be fetched are skipped.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Dump(const std::string &outf, TreeDumpFormat format) {
   std::ofstream out(outf);
-  out << "digraph G {" << std::endl;
-  ToGraph(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm, out);
-  out << "}" << std::endl;
-  out.flush();
+  root_latch_.RLock();
+  Page *root = IsEmpty() ? nullptr : buffer_pool_manager_->FetchPage(root_page_id_, partition_);
+  if (format == TreeDumpFormat::GRAPHVIZ) {
+    out << "digraph G {" << std::endl;
+    if (root != nullptr) {
+      ToGraph(reinterpret_cast<BPlusTreePage *>(root->GetData()), buffer_pool_manager_, out);
+    }
+    out << "}" << std::endl;
+  } else {
+    if (root != nullptr) {
+      ToJson(reinterpret_cast<BPlusTreePage *>(root->GetData()), buffer_pool_manager_, out);
+    } else {
+      out << "null";
+    }
+    out << std::endl;
+  }
+  root_latch_.RUnlock();
   out.close();
 }
 
@@ -824,11 +1872,17 @@ void BPLUSTREE_TYPE::Draw(BufferPoolManager *bpm, const std::string &outf) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Print(BufferPoolManager *bpm) {
+  root_latch_.RLock();
   if (IsEmpty()) {
+    root_latch_.RUnlock();
     LOG_WARN("Print an empty tree");
     return;
   }
-  ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm);
+  auto *root = bpm->FetchPage(root_page_id_, partition_);
+  if (root != nullptr) {
+    ToString(reinterpret_cast<BPlusTreePage *>(root->GetData()), bpm);
+  }
+  root_latch_.RUnlock();
 }
 
 /**
@@ -906,23 +1960,61 @@ void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::o
       out << internal_prefix << inner->GetParentPageId() << ":p" << inner->GetPageId() << " -> " << internal_prefix
           << inner->GetPageId() << ";\n";
     }
-    // Print leaves
+    // Print leaves; a child is unpinned by the time ToGraph() returns
     for (int i = 0; i < inner->GetSize(); i++) {
-      auto child_page = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(inner->ValueAt(i))->GetData());
+      auto *child = bpm->FetchPage(inner->ValueAt(i), partition_);
+      if (child == nullptr) {
+        LOG_WARN("Cannot fetch page %d", inner->ValueAt(i));
+        continue;
+      }
+      auto child_page = reinterpret_cast<BPlusTreePage *>(child->GetData());
+      bool child_is_leaf = child_page->IsLeafPage();
       ToGraph(child_page, bpm, out);
-      if (i > 0) {
-        auto sibling_page = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(inner->ValueAt(i - 1))->GetData());
-        if (!sibling_page->IsLeafPage() && !child_page->IsLeafPage()) {
-          out << "{rank=same " << internal_prefix << sibling_page->GetPageId() << " " << internal_prefix
-              << child_page->GetPageId() << "};\n";
-        }
-        bpm->UnpinPage(sibling_page->GetPageId(), false);
+      if (i > 0 && !child_is_leaf) {
+        out << "{rank=same " << internal_prefix << inner->ValueAt(i - 1) << " " << internal_prefix
+            << inner->ValueAt(i) << "};\n";
       }
     }
   }
   bpm->UnpinPage(page->GetPageId(), false);
 }
 
+/**
+ * Write a node and, nested in it, its children as JSON, see Dump(). Unpins
+ * the node.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ToJson(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const {
+  out << "{\"page_id\":" << page->GetPageId() << ",\"parent_page_id\":" << page->GetParentPageId()
+      << ",\"size\":" << page->GetSize() << ",\"max_size\":" << page->GetMaxSize();
+  if (page->IsLeafPage()) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page);
+    out << ",\"type\":\"leaf\",\"next_page_id\":" << leaf->GetNextPageId() << ",\"keys\":[";
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      out << (i > 0 ? "," : "") << leaf->KeyAt(i);
+    }
+    out << "]}";
+  } else {
+    auto *inner = reinterpret_cast<InternalPage *>(page);
+    out << ",\"type\":\"internal\",\"keys\":[";
+    for (int i = 1; i < inner->GetSize(); i++) {
+      out << (i > 1 ? "," : "") << inner->KeyAt(i);
+    }
+    out << "],\"children\":[";
+    for (int i = 0; i < inner->GetSize(); i++) {
+      out << (i > 0 ? "," : "");
+      auto *child = bpm->FetchPage(inner->ValueAt(i), partition_);
+      if (child == nullptr) {
+        out << "{\"page_id\":" << inner->ValueAt(i) << ",\"error\":\"cannot fetch page\"}";
+        continue;
+      }
+      ToJson(reinterpret_cast<BPlusTreePage *>(child->GetData()), bpm, out);
+    }
+    out << "]}";
+  }
+  bpm->UnpinPage(page->GetPageId(), false);
+}
+
 /**
  * This function is for debug only, you don't need to modify
  * @tparam KeyType
@@ -951,7 +2043,12 @@ void BPLUSTREE_TYPE::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const
     std::cout << std::endl;
     std::cout << std::endl;
     for (int i = 0; i < internal->GetSize(); i++) {
-      ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(internal->ValueAt(i))->GetData()), bpm);
+      auto *child = bpm->FetchPage(internal->ValueAt(i), partition_);
+      if (child == nullptr) {
+        LOG_WARN("Cannot fetch page %d", internal->ValueAt(i));
+        continue;
+      }
+      ToString(reinterpret_cast<BPlusTreePage *>(child->GetData()), bpm);
     }
   }
   bpm->UnpinPage(page->GetPageId(), false);
@@ -0,0 +1,251 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/include/index/b_plus_tree.h
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/rwlatch.h"
+#include "concurrency/transaction.h"
+#include "storage/index/index_iterator.h"
+#include "storage/index/index_snapshot.h"
+#include "storage/index/key_file_reader.h"
+#include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+
+namespace bustub {
+
+#define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
+
+/** Smallest node size a tree can be configured with; the largest is the frame size, BUSTUB_PAGE_SIZE. */
+static constexpr size_t BPLUSTREE_MIN_PAGE_SIZE = 512;
+/** Number of contiguous page ids a tree reserves at a time for its leaves. */
+static constexpr int BPLUSTREE_EXTENT_SIZE = 64;
+/** Most entries a snapshot export copies out of the tree per acquisition of the root latch. */
+static constexpr size_t BPLUSTREE_EXPORT_CHUNK_SIZE = 4096;
+/** Most nodes of one level a snapshot import creates with one NewPages() call. */
+static constexpr size_t BPLUSTREE_BUILD_CHUNK_SIZE = 64;
+/** Number of keys InsertFromFile() reads, sorts and inserts at a time. */
+static constexpr size_t BPLUSTREE_LOAD_BATCH_SIZE = 1 << 16;
+/** Number of parsed batches InsertFromFile() lets its reader thread run ahead. */
+static constexpr size_t BPLUSTREE_LOAD_QUEUE_DEPTH = 2;
+
+/** Output format of BPlusTree::Dump(). */
+enum class TreeDumpFormat { GRAPHVIZ, JSON };
+
+/**
+ * Main class providing the API for the Interactive B+ Tree.
+ *
+ * Implementation of simple b+ tree data structure where internal pages direct
+ * the search and leaf pages contain actual data.
+ * (1) We only support unique key
+ * (2) support insert & remove
+ * (3) The structure should shrink and grow dynamically
+ * (4) Implement index iterator for range scan
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree {
+  using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
+ public:
+  /**
+   * @param leaf_max_size max entries per leaf, 0 = as many as fit in a node of page_size bytes
+   * @param internal_max_size max children per internal node, 0 = as many as fit in a node of page_size bytes
+   * @param page_size node size in bytes: a power of two between BPLUSTREE_MIN_PAGE_SIZE and BUSTUB_PAGE_SIZE
+   * @param partition buffer pool partition the tree's pages are charged to (see
+   * BufferPoolManager::CreatePartition()), INVALID_PARTITION_ID for none
+   */
+  explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                     int leaf_max_size = 0, int internal_max_size = 0, size_t page_size = BUSTUB_PAGE_SIZE,
+                     partition_id_t partition = INVALID_PARTITION_ID);
+
+  // unpin the pinned top levels and give the unused rest of the leaf extent
+  // back to the buffer pool manager, which must still exist
+  ~BPlusTree();
+
+  // Returns true if this B+ tree has no keys and values.
+  auto IsEmpty() const -> bool;
+
+  // Insert a key-value pair into this B+ tree.
+  auto Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr) -> bool;
+
+  // Insert key-value pairs, best sorted, sharing one traversal among the
+  // pairs that go to the same leaf; returns the number of pairs inserted.
+  auto InsertBatch(const std::vector<std::pair<KeyType, ValueType>> &entries, Transaction *transaction = nullptr)
+      -> size_t;
+
+  // Remove a key and its value from this B+ tree.
+  void Remove(const KeyType &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  auto GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr) -> bool;
+
+  // return the page id of the root node
+  auto GetRootPageId() -> page_id_t;
+
+  // adopt the root page id recorded for this index in the header page
+  auto LoadRootPageId() -> bool;
+
+  // keep the nodes of the top levels permanently pinned, 0 to release them
+  void PinTopLevels(int levels);
+
+  // return the node size this tree was configured with
+  auto GetPageSize() const -> size_t { return page_size_; }
+
+  // index iterator
+  auto Begin() -> INDEXITERATOR_TYPE;
+  auto Begin(const KeyType &key) -> INDEXITERATOR_TYPE;
+  auto End() -> INDEXITERATOR_TYPE;
+
+  // print the B+ tree
+  void Print(BufferPoolManager *bpm);
+
+  // draw the B+ tree
+  void Draw(BufferPoolManager *bpm, const std::string &outf);
+
+  // write the B+ tree to a file as Graphviz or JSON
+  void Dump(const std::string &outf, TreeDumpFormat format);
+
+  // check the structure of the B+ tree, using up to threads threads; returns
+  // false and describes the first violation found in error
+  auto Verify(std::string *error = nullptr, size_t threads = 1) -> bool;
+
+  // read keys from a text file and insert them
+  void InsertFromFile(const std::string &file_name, Transaction *transaction = nullptr);
+
+  // read keys from a text or binary file in sorted batches and insert them,
+  // parsing the next batches on a second thread if pipelined; returns the
+  // number of keys inserted. Throws on a read error or a malformed file, after
+  // inserting the batches before the error
+  auto InsertFromFile(const std::string &file_name, KeyFileFormat format, bool pipelined = true,
+                      Transaction *transaction = nullptr) -> size_t;
+
+  // read keys from a text file and remove them one by one
+  void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
+
+  // write all entries in key order to a block-compressed, checksummed
+  // snapshot file, blocking writers only while a chunk of entries is copied
+  // out, so changes made meanwhile may or may not be included; returns the
+  // number of entries written
+  auto ExportSnapshot(const std::string &file_name) -> size_t;
+
+  // build this tree, which must be empty, bottom-up from a snapshot written
+  // by ExportSnapshot(); returns the number of entries loaded
+  auto ImportSnapshot(const std::string &file_name) -> size_t;
+
+ private:
+  friend INDEXITERATOR_TYPE;
+
+  enum class Operation { SEARCH, INSERT, DELETE };
+
+  // latch crabbing helpers
+  template <typename N>
+  auto IsSafe(N *node, Operation op) -> bool;
+  void UnlockUnpinPages(Transaction *transaction);
+  void UnlockPages(Transaction *transaction);
+  auto FindLeafPage(const KeyType &key, bool leftMost, Operation op, Transaction *transaction) -> Page *;
+
+  // page allocation
+  auto NewLeafPage(page_id_t *page_id, page_id_t hint) -> Page *;
+
+  // pinned top levels
+  auto FetchNode(page_id_t page_id, bool *pinned) -> Page *;
+  void RefreshPinnedLevels();
+  void DeleteNode(page_id_t page_id, Transaction *transaction);
+
+  // deletion of pages an iterator may still pin
+  void DeletePageOrDefer(page_id_t page_id);
+  void RetryPendingDeletes();
+  auto PinNode(page_id_t page_id, Transaction *transaction) -> Page *;
+  void UnpinNode(Page *page, bool is_dirty);
+
+  // insertion helpers
+  void StartNewTree(const KeyType &key, const ValueType &value);
+  auto InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool;
+  auto Split(LeafPage *leaf_page) -> LeafPage *;
+  auto Split(InternalPage *internal_page) -> InternalPage *;
+  void LeafBounds(page_id_t leaf_page_id, Transaction *transaction, KeyType *lower, bool *has_lower, KeyType *upper,
+                  bool *has_upper);
+  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
+                        Transaction *transaction);
+  auto BuildFromSnapshot(IndexSnapshotReader *reader, std::vector<page_id_t> *built) -> page_id_t;
+
+  // deletion helpers
+  template <typename N>
+  auto CoalesceOrRedistribute(N *node, Transaction *transaction) -> bool;
+  auto AdjustRoot(BPlusTreePage *old_root_node) -> bool;
+  template <typename N>
+  void Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index, bool from_left);
+  template <typename N>
+  auto Coalesce(N *neighbor_node, N *node, InternalPage *parent, int index, Transaction *transaction) -> bool;
+
+  void UpdateRootPageId(int insert_record = 0);
+
+  // verification helpers
+  /** What VerifySubtree() found in a subtree, in key order. */
+  struct VerifySummary {
+    page_id_t first_leaf_{INVALID_PAGE_ID};
+    page_id_t last_leaf_{INVALID_PAGE_ID};
+    // next page id of last_leaf_
+    page_id_t last_next_{INVALID_PAGE_ID};
+    int leaf_depth_{-1};
+    size_t entries_{0};
+    std::string error_;
+  };
+  auto CheckNode(BPlusTreePage *node, page_id_t page_id, page_id_t parent_id, const KeyType &lower, bool has_lower,
+                 const KeyType &upper, bool has_upper, std::string *error) const -> bool;
+  auto VerifySubtree(page_id_t page_id, page_id_t parent_id, int depth, const KeyType &lower, bool has_lower,
+                     const KeyType &upper, bool has_upper, VerifySummary *summary) const -> bool;
+
+  /* Debug Routines for FREE!! */
+  void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const;
+
+  void ToJson(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const;
+
+  void ToString(BPlusTreePage *page, BufferPoolManager *bpm) const;
+
+  // member variable
+  std::string index_name_;
+  page_id_t root_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  size_t page_size_;
+  int leaf_max_size_;
+  int internal_max_size_;
+  partition_id_t partition_;
+  // unused part [extent_next_, extent_end_) of the extent new leaves are allocated from
+  page_id_t extent_next_{INVALID_PAGE_ID};
+  page_id_t extent_end_{INVALID_PAGE_ID};
+  // nodes of the top pinned_levels_ levels, each holding one permanent pin;
+  // stale once a structural change touched them, until RefreshPinnedLevels()
+  int pinned_levels_{0};
+  std::unordered_map<page_id_t, Page *> pinned_pages_;
+  bool pinned_stale_{false};
+  // protects root_page_id_, the extent and the pinned levels
+  ReaderWriterLatch root_latch_{"root"};
+  // bumped whenever entries move from one leaf to another, so an iterator can
+  // tell whether the leaf chain changed while it held no latch
+  std::atomic<uint64_t> structure_version_{0};
+  // pages removed from the tree whose deletion failed because an iterator
+  // still pinned them; retried when an iterator drops a pin and after each
+  // structural change
+  std::mutex pending_latch_;
+  std::vector<page_id_t> pending_deletes_;
+  std::atomic<bool> has_pending_deletes_{false};
+};
+
+}  // namespace bustub
@@ -133,14 +133,15 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value,
  * Move half of items to recipient (for split)
  * @param recipient: the new internal page created from split
  * @param buffer_pool_manager: used to update parent pointers of moved children
+ * @param partition: the partition the moved children are fetched into
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
-                                                BufferPoolManager *buffer_pool_manager) {
+                                                BufferPoolManager *buffer_pool_manager, partition_id_t partition) {
   int start_idx = GetSize() / 2;
   int move_count = GetSize() - start_idx;
 
-  recipient->CopyNFrom(array_ + start_idx, move_count, buffer_pool_manager);
+  recipient->CopyNFrom(array_ + start_idx, move_count, buffer_pool_manager, partition);
   IncreaseSize(-move_count);
 }
 
@@ -148,12 +149,13 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient
  * Copy items into this internal page from source
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager,
+                                               partition_id_t partition) {
   int start = GetSize();
   for (int i = 0; i < size; ++i) {
     array_[start + i] = items[i];
     // Update parent pointer of the child page
-    auto *page = buffer_pool_manager->FetchPage(items[i].second);
+    auto *page = buffer_pool_manager->FetchPage(items[i].second, partition);
     auto *child = reinterpret_cast<BPlusTreePage *>(page->GetData());
     child->SetParentPageId(GetPageId());
     buffer_pool_manager->UnpinPage(items[i].second, true);
@@ -179,11 +181,11 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                               BufferPoolManager *buffer_pool_manager) {
+                                               BufferPoolManager *buffer_pool_manager, partition_id_t partition) {
   // The first key of this page is invalid, replace it with middle_key
   array_[0].first = middle_key;
 
-  recipient->CopyNFrom(array_, GetSize(), buffer_pool_manager);
+  recipient->CopyNFrom(array_, GetSize(), buffer_pool_manager, partition);
   SetSize(0);
 }
 
@@ -193,9 +195,10 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                      BufferPoolManager *buffer_pool_manager) {
+                                                      BufferPoolManager *buffer_pool_manager,
+                                                      partition_id_t partition) {
   MappingType pair{middle_key, array_[0].second};
-  recipient->CopyLastFrom(pair, buffer_pool_manager);
+  recipient->CopyLastFrom(pair, buffer_pool_manager, partition);
 
   // Shift remaining elements (but keep array_[0].first invalid for internal page)
   for (int i = 0; i < GetSize() - 1; ++i) {
@@ -208,11 +211,12 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *rec
  * Append an entry at the end of this internal page
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager,
+                                                  partition_id_t partition) {
   array_[GetSize()] = pair;
 
   // Update parent pointer of the child page
-  auto *page = buffer_pool_manager->FetchPage(pair.second);
+  auto *page = buffer_pool_manager->FetchPage(pair.second, partition);
   auto *child = reinterpret_cast<BPlusTreePage *>(page->GetData());
   child->SetParentPageId(GetPageId());
   buffer_pool_manager->UnpinPage(pair.second, true);
@@ -226,9 +230,12 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, Buffe
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                       BufferPoolManager *buffer_pool_manager) {
-  MappingType pair{middle_key, array_[GetSize() - 1].second};
-  recipient->CopyFirstFrom(pair, buffer_pool_manager);
+                                                       BufferPoolManager *buffer_pool_manager,
+                                                       partition_id_t partition) {
+  // The invalid first key of recipient moves to slot 1 and becomes middle_key;
+  // the moved key lands in slot 0, from where the caller copies it up into the parent
+  recipient->SetKeyAt(0, middle_key);
+  recipient->CopyFirstFrom(array_[GetSize() - 1], buffer_pool_manager, partition);
   IncreaseSize(-1);
 }
 
@@ -236,14 +243,15 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *re
  * Insert an entry at the front of this internal page (shift existing elements)
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager,
+                                                   partition_id_t partition) {
   for (int i = GetSize(); i > 0; --i) {
     array_[i] = array_[i - 1];
   }
   array_[0] = pair;
 
   // Update parent pointer of the child page
-  auto *page = buffer_pool_manager->FetchPage(pair.second);
+  auto *page = buffer_pool_manager->FetchPage(pair.second, partition);
   auto *child = reinterpret_cast<BPlusTreePage *>(page->GetData());
   child->SetParentPageId(GetPageId());
   buffer_pool_manager->UnpinPage(pair.second, true);
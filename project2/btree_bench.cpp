@@ -0,0 +1,567 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// btree_bench.cpp
+//
+// Identification: tools/btree_bench/btree_bench.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>  // NOLINT
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/access_trace.h"
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/exception.h"
+#include "common/metrics.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/disk/memory_disk_manager.h"
+#include "storage/disk/throttled_disk_manager.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h"  // NOLINT
+
+/**
+ * YCSB-style benchmark of BPlusTree over BufferPoolManagerInstance.
+ *
+ * The load phase inserts --records keys from --threads threads. The run phase
+ * then executes --operations operations of one of the YCSB core workloads:
+ *
+ *   A  50% read, 50% update                   zipfian
+ *   B  95% read,  5% update                   zipfian
+ *   C  100% read                              zipfian
+ *   D  95% read,  5% insert                   latest
+ *   E  95% scan,  5% insert                   zipfian, scans of 1..--max_scan_length entries
+ *   F  50% read, 50% read-modify-write        zipfian
+ *
+ * --distribution overrides the key distribution of the workload. Key ids are
+ * spread over the key space by a bijective hash, like YCSB's hashed insert
+ * order, so the hot keys of the zipfian distribution are not adjacent. Make
+ * --pool_size (in frames) smaller than the tree to run out of core.
+ *
+ * --disk=memory keeps the pages in memory instead of btree_bench.db. Any of
+ * --read_latency_us, --write_latency_us, --bandwidth_mb (MB/s) and --iops
+ * puts a ThrottledDiskManager in front, so an out-of-core run over a memory
+ * disk takes the same time on every machine.
+ *
+ * --trace writes the buffer pool calls of the run phase to FILE with
+ * AccessTracer, for replaying the page reference string against other
+ * replacers.
+ *
+ * The result, including the latency percentiles of every operation type and
+ * the MetricsRegistry counters of the run phase, is written as one JSON
+ * object to stdout or --output; a summary goes to stderr. Every thread draws
+ * from its own generator seeded from --seed, so the operation sequence of a
+ * run is reproducible, the interleaving of the threads is not.
+ *
+ * BPlusTree has no in-place update, so an update removes the key and inserts
+ * it again. A scan holds a read latch on one leaf at a time.
+ *
+ * Usage: btree_bench [--workload=A..F] [--distribution=uniform|zipfian|latest] [--records=N] [--operations=N]
+ *                    [--threads=N] [--pool_size=FRAMES] [--leaf_max_size=N] [--internal_max_size=N]
+ *                    [--max_scan_length=N] [--seed=N] [--disk=file|memory] [--read_latency_us=N]
+ *                    [--write_latency_us=N] [--bandwidth_mb=N] [--iops=N] [--trace=FILE] [--output=FILE]
+ */
+
+namespace {
+
+using KeyType = bustub::GenericKey<8>;
+using ValueType = bustub::RID;
+using ComparatorType = bustub::GenericComparator<8>;
+using TreeType = bustub::BPlusTree<KeyType, ValueType, ComparatorType>;
+
+/** Skew of the zipfian distribution, YCSB's default. */
+constexpr double ZIPFIAN_THETA = 0.99;
+
+enum class Distribution { UNIFORM, ZIPFIAN, LATEST };
+
+enum OpType { READ, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE, NUM_OP_TYPES };
+
+constexpr std::array<const char *, NUM_OP_TYPES> OP_NAMES = {"read", "update", "insert", "scan", "read_modify_write"};
+
+struct Workload {
+  char name_;
+  /** Share of each operation type, summing up to 1. */
+  std::array<double, NUM_OP_TYPES> mix_;
+  Distribution distribution_;
+};
+
+constexpr std::array<Workload, 6> WORKLOADS = {{
+    {'A', {0.5, 0.5, 0, 0, 0}, Distribution::ZIPFIAN},
+    {'B', {0.95, 0.05, 0, 0, 0}, Distribution::ZIPFIAN},
+    {'C', {1, 0, 0, 0, 0}, Distribution::ZIPFIAN},
+    {'D', {0.95, 0, 0.05, 0, 0}, Distribution::LATEST},
+    {'E', {0, 0, 0.05, 0.95, 0}, Distribution::ZIPFIAN},
+    {'F', {0.5, 0, 0, 0, 0.5}, Distribution::ZIPFIAN},
+}};
+
+struct Config {
+  const Workload *workload_{&WORKLOADS[0]};
+  Distribution distribution_{Distribution::ZIPFIAN};
+  bool distribution_set_{false};
+  size_t records_{1000000};
+  size_t operations_{1000000};
+  size_t threads_{4};
+  size_t pool_size_{16384};
+  int leaf_max_size_{0};
+  int internal_max_size_{0};
+  size_t max_scan_length_{100};
+  uint64_t seed_{42};
+  bool memory_disk_{false};
+  bustub::ThrottledDiskManager::Options throttle_;
+  std::string trace_;
+  std::string output_;
+};
+
+auto DistributionName(Distribution distribution) -> const char * {
+  switch (distribution) {
+    case Distribution::UNIFORM:
+      return "uniform";
+    case Distribution::ZIPFIAN:
+      return "zipfian";
+    case Distribution::LATEST:
+      return "latest";
+  }
+  return "";
+}
+
+/** @return false on an unknown or malformed option */
+auto ParseArgs(int argc, char **argv, Config *config) -> bool {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      return false;
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    char *end = nullptr;
+    uint64_t number = std::strtoull(value.c_str(), &end, 10);
+    bool is_number = !value.empty() && *end == '\0';
+
+    if (name == "workload") {
+      auto it = std::find_if(WORKLOADS.begin(), WORKLOADS.end(), [&](const Workload &workload) {
+        return value.size() == 1 && std::toupper(value[0]) == workload.name_;
+      });
+      if (it == WORKLOADS.end()) {
+        return false;
+      }
+      config->workload_ = &*it;
+    } else if (name == "distribution") {
+      if (value == "uniform") {
+        config->distribution_ = Distribution::UNIFORM;
+      } else if (value == "zipfian") {
+        config->distribution_ = Distribution::ZIPFIAN;
+      } else if (value == "latest") {
+        config->distribution_ = Distribution::LATEST;
+      } else {
+        return false;
+      }
+      config->distribution_set_ = true;
+    } else if (name == "disk") {
+      if (value != "file" && value != "memory") {
+        return false;
+      }
+      config->memory_disk_ = value == "memory";
+    } else if (name == "trace") {
+      config->trace_ = value;
+    } else if (name == "output") {
+      config->output_ = value;
+    } else if (!is_number) {
+      return false;
+    } else if (name == "records") {
+      config->records_ = number;
+    } else if (name == "operations") {
+      config->operations_ = number;
+    } else if (name == "threads") {
+      config->threads_ = number;
+    } else if (name == "pool_size") {
+      config->pool_size_ = number;
+    } else if (name == "leaf_max_size") {
+      config->leaf_max_size_ = static_cast<int>(number);
+    } else if (name == "internal_max_size") {
+      config->internal_max_size_ = static_cast<int>(number);
+    } else if (name == "max_scan_length") {
+      config->max_scan_length_ = number;
+    } else if (name == "seed") {
+      config->seed_ = number;
+    } else if (name == "read_latency_us") {
+      config->throttle_.read_latency_us_ = number;
+    } else if (name == "write_latency_us") {
+      config->throttle_.write_latency_us_ = number;
+    } else if (name == "bandwidth_mb") {
+      config->throttle_.bandwidth_bytes_per_sec_ = number * 1000000;
+    } else if (name == "iops") {
+      config->throttle_.iops_ = number;
+    } else {
+      return false;
+    }
+  }
+  if (!config->distribution_set_) {
+    config->distribution_ = config->workload_->distribution_;
+  }
+  return config->records_ >= 2 && config->threads_ > 0 && config->max_scan_length_ > 0;
+}
+
+/** Map a key id to its key. A bijection on 64 bits (the splitmix64 finalizer), so distinct ids get distinct keys. */
+auto KeyOf(uint64_t id) -> KeyType {
+  uint64_t x = id;
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  KeyType key;
+  key.SetFromInteger(static_cast<int64_t>(x));
+  return key;
+}
+
+/** Zipfian ranks over [0, items), rank 0 the most popular; the generator of Gray et al. that YCSB uses. */
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(uint64_t items, double theta) : items_(items), theta_(theta) {
+    double zeta2 = Zeta(2);
+    zetan_ = Zeta(items);
+    alpha_ = 1.0 / (1.0 - theta);
+    eta_ = (1.0 - std::pow(2.0 / static_cast<double>(items), 1.0 - theta)) / (1.0 - zeta2 / zetan_);
+  }
+
+  auto Next(std::mt19937_64 *rng) const -> uint64_t {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(*rng);
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    auto rank = static_cast<uint64_t>(static_cast<double>(items_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(rank, items_ - 1);
+  }
+
+ private:
+  auto Zeta(uint64_t n) const -> double {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta_);
+    }
+    return sum;
+  }
+
+  uint64_t items_;
+  double theta_;
+  double zetan_;
+  double alpha_;
+  double eta_;
+};
+
+/** Shared state of the run phase. */
+struct RunState {
+  const Config *config_;
+  TreeType *tree_;
+  ZipfianGenerator *zipfian_;
+  /** Ids below this are inserted or being inserted. */
+  std::atomic<uint64_t> next_id_;
+  std::array<bustub::Histogram, NUM_OP_TYPES> latency_;
+  std::array<std::atomic<uint64_t>, NUM_OP_TYPES> count_{};
+  /** Reads, updates and read-modify-writes that did not find their key, and inserts of a key that existed. */
+  std::array<std::atomic<uint64_t>, NUM_OP_TYPES> missed_{};
+  std::atomic<bool> failed_{false};
+  std::string error_;
+  std::mutex error_latch_;
+};
+
+auto NextKeyId(RunState *state, std::mt19937_64 *rng) -> uint64_t {
+  uint64_t inserted = state->next_id_.load(std::memory_order_relaxed);
+  switch (state->config_->distribution_) {
+    case Distribution::UNIFORM:
+      return std::uniform_int_distribution<uint64_t>(0, inserted - 1)(*rng);
+    case Distribution::ZIPFIAN:
+      // Ranks over the loaded records: the hot set stays the same while the workload inserts
+      return state->zipfian_->Next(rng);
+    case Distribution::LATEST:
+      return inserted - 1 - std::min(state->zipfian_->Next(rng), inserted - 1);
+  }
+  return 0;
+}
+
+/** @return false if the key was missing (or, for an insert, present) */
+auto RunOp(RunState *state, OpType op, std::mt19937_64 *rng, uint64_t *checksum) -> bool {
+  TreeType *tree = state->tree_;
+  std::vector<ValueType> result;
+  switch (op) {
+    case READ: {
+      uint64_t id = NextKeyId(state, rng);
+      return tree->GetValue(KeyOf(id), &result);
+    }
+    case UPDATE: {
+      uint64_t id = NextKeyId(state, rng);
+      KeyType key = KeyOf(id);
+      tree->Remove(key);
+      return tree->Insert(key, ValueType(static_cast<int64_t>(id)));
+    }
+    case INSERT: {
+      uint64_t id = state->next_id_.fetch_add(1, std::memory_order_relaxed);
+      return tree->Insert(KeyOf(id), ValueType(static_cast<int64_t>(id)));
+    }
+    case SCAN: {
+      uint64_t id = NextKeyId(state, rng);
+      size_t length = std::uniform_int_distribution<size_t>(1, state->config_->max_scan_length_)(*rng);
+      auto it = tree->Begin(KeyOf(id));
+      for (size_t n = 0; n < length && !it.IsEnd(); n++, ++it) {
+        *checksum += (*it).second.GetSlotNum();
+      }
+      return true;
+    }
+    case READ_MODIFY_WRITE: {
+      uint64_t id = NextKeyId(state, rng);
+      KeyType key = KeyOf(id);
+      if (!tree->GetValue(key, &result)) {
+        return false;
+      }
+      tree->Remove(key);
+      return tree->Insert(key, ValueType(result[0].Get() + 1));
+    }
+    default:
+      return false;
+  }
+}
+
+/** Run fn(t) on threads threads and return the wall time in seconds. */
+template <typename Fn>
+auto RunThreads(RunState *state, size_t threads, Fn fn) -> double {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([state, fn, t] {
+      try {
+        fn(t);
+      } catch (const bustub::Exception &e) {
+        std::scoped_lock<std::mutex> lock(state->error_latch_);
+        state->error_ = e.what();
+        state->failed_ = true;
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** @return whether any limit of the simulated disk is set */
+auto IsThrottled(const Config &config) -> bool {
+  const auto &throttle = config.throttle_;
+  return throttle.read_latency_us_ != 0 || throttle.write_latency_us_ != 0 ||
+         throttle.bandwidth_bytes_per_sec_ != 0 || throttle.iops_ != 0;
+}
+
+/** @param disk the I/O of the run phase on the simulated disk, nullptr if there is none */
+auto FormatResult(const Config &config, RunState *state, double load_seconds, double run_seconds,
+                  const bustub::ThrottledDiskManager::Stats *disk) -> std::string {
+  std::string out;
+  char item[512];
+  snprintf(item, sizeof(item),
+           "{\"config\":{\"workload\":\"%c\",\"distribution\":\"%s\",\"records\":%zu,\"operations\":%zu,"
+           "\"threads\":%zu,\"pool_size\":%zu,\"leaf_max_size\":%d,\"internal_max_size\":%d,"
+           "\"max_scan_length\":%zu,\"seed\":%llu,",
+           config.workload_->name_, DistributionName(config.distribution_), config.records_, config.operations_,
+           config.threads_, config.pool_size_, config.leaf_max_size_, config.internal_max_size_,
+           config.max_scan_length_, static_cast<unsigned long long>(config.seed_));  // NOLINT
+  out += item;
+  snprintf(item, sizeof(item),
+           "\"disk\":\"%s\",\"read_latency_us\":%llu,\"write_latency_us\":%llu,\"bandwidth_mb\":%llu,"
+           "\"iops\":%llu},",
+           config.memory_disk_ ? "memory" : "file",
+           static_cast<unsigned long long>(config.throttle_.read_latency_us_),              // NOLINT
+           static_cast<unsigned long long>(config.throttle_.write_latency_us_),             // NOLINT
+           static_cast<unsigned long long>(config.throttle_.bandwidth_bytes_per_sec_ / 1000000),  // NOLINT
+           static_cast<unsigned long long>(config.throttle_.iops_));                        // NOLINT
+  out += item;
+  if (disk != nullptr) {
+    snprintf(item, sizeof(item),
+             "\"disk\":{\"pages_read\":%llu,\"pages_written\":%llu,\"queue_ms\":%.3f,\"delay_ms\":%.3f},",
+             static_cast<unsigned long long>(disk->pages_read_),     // NOLINT
+             static_cast<unsigned long long>(disk->pages_written_),  // NOLINT
+             disk->queue_ns_ / 1e6, disk->delay_ns_ / 1e6);
+    out += item;
+  }
+  snprintf(item, sizeof(item), "\"load\":{\"seconds\":%.3f,\"ops_per_sec\":%.1f},", load_seconds,
+           static_cast<double>(config.records_) / load_seconds);
+  out += item;
+  snprintf(item, sizeof(item), "\"run\":{\"seconds\":%.3f,\"ops_per_sec\":%.1f,\"ops\":{", run_seconds,
+           static_cast<double>(config.operations_) / run_seconds);
+  out += item;
+  bool first = true;
+  for (int op = 0; op < NUM_OP_TYPES; op++) {
+    bustub::HistogramSnapshot latency = state->latency_[op].Snapshot();
+    if (latency.count_ == 0) {
+      continue;
+    }
+    snprintf(item, sizeof(item),
+             "%s\"%s\":{\"count\":%llu,\"missed\":%llu,\"mean_ns\":%.1f,\"p50_ns\":%llu,\"p90_ns\":%llu,"
+             "\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}",
+             first ? "" : ",", OP_NAMES[op], static_cast<unsigned long long>(latency.count_),  // NOLINT
+             static_cast<unsigned long long>(state->missed_[op].load()), latency.Mean(),         // NOLINT
+             static_cast<unsigned long long>(latency.Percentile(0.5)),                           // NOLINT
+             static_cast<unsigned long long>(latency.Percentile(0.9)),                           // NOLINT
+             static_cast<unsigned long long>(latency.Percentile(0.99)),                          // NOLINT
+             static_cast<unsigned long long>(latency.Percentile(0.999)),                         // NOLINT
+             static_cast<unsigned long long>(latency.max_));                                     // NOLINT
+    out += item;
+    first = false;
+  }
+  out += "}},\"metrics\":";
+  out += bustub::MetricsRegistry::Instance().Snapshot().ToJson();
+  out += "}\n";
+  return out;
+}
+
+}  // namespace
+
+auto main(int argc, char **argv) -> int {
+  Config config;
+  if (!ParseArgs(argc, argv, &config)) {
+    fprintf(stderr,
+            "usage: %s [--workload=A..F] [--distribution=uniform|zipfian|latest] [--records=N] [--operations=N]\n"
+            "       [--threads=N] [--pool_size=FRAMES] [--leaf_max_size=N] [--internal_max_size=N]\n"
+            "       [--max_scan_length=N] [--seed=N] [--disk=file|memory] [--read_latency_us=N]\n"
+            "       [--write_latency_us=N] [--bandwidth_mb=N] [--iops=N] [--trace=FILE] [--output=FILE]\n",
+            argv[0]);
+    return 1;
+  }
+
+  const std::string db_file = "btree_bench.db";
+  bustub::DiskManager *disk_manager;
+  if (config.memory_disk_) {
+    disk_manager = new bustub::MemoryDiskManager();
+  } else {
+    disk_manager = new bustub::DiskManager(db_file);
+  }
+  // The buffer pool does its I/O through the simulated device, if there is one
+  bustub::ThrottledDiskManager *throttled = nullptr;
+  if (IsThrottled(config)) {
+    throttled = new bustub::ThrottledDiskManager(disk_manager, config.throttle_);
+  }
+  auto *bpm = new bustub::BufferPoolManagerInstance(
+      config.pool_size_, throttled != nullptr ? static_cast<bustub::DiskManager *>(throttled) : disk_manager);
+  bustub::page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  auto key_schema = bustub::ParseCreateStatement("a bigint");
+  ComparatorType comparator(key_schema.get());
+  auto *tree = new TreeType("btree_bench", bpm, comparator, config.leaf_max_size_, config.internal_max_size_);
+
+  fprintf(stderr, "computing zipfian constants for %zu records\n", config.records_);
+  ZipfianGenerator zipfian(config.records_, ZIPFIAN_THETA);
+  RunState state;
+  state.config_ = &config;
+  state.tree_ = tree;
+  state.zipfian_ = &zipfian;
+  state.next_id_ = config.records_;
+
+  // Load: every thread inserts its share of the ids
+  double load_seconds = RunThreads(&state, config.threads_, [&](size_t t) {
+    for (uint64_t id = t; id < config.records_ && !state.failed_; id += config.threads_) {
+      tree->Insert(KeyOf(id), ValueType(static_cast<int64_t>(id)));
+    }
+  });
+  fprintf(stderr, "load: %zu records in %.3f s\n", config.records_, load_seconds);
+
+  // Run: the metrics of the result cover the run phase only
+  bustub::MetricsRegistry::Instance().Reset();
+  bustub::ThrottledDiskManager::Stats disk_before{};
+  if (throttled != nullptr) {
+    disk_before = throttled->GetStats();
+  }
+  bool tracing = !config.trace_.empty() && bustub::AccessTracer::Instance().Start(config.trace_);
+  if (!config.trace_.empty() && !tracing) {
+    state.error_ = "can't write " + config.trace_;
+    state.failed_ = true;
+  }
+  const Workload &workload = *config.workload_;
+  std::atomic<uint64_t> checksum{0};
+  double run_seconds = RunThreads(&state, config.threads_, [&](size_t t) {
+    std::mt19937_64 rng(config.seed_ + t);
+    std::uniform_real_distribution<double> pick(0.0, 1.0);
+    uint64_t local_checksum = 0;
+    size_t operations = config.operations_ / config.threads_ + (t < config.operations_ % config.threads_ ? 1 : 0);
+    for (size_t i = 0; i < operations && !state.failed_; i++) {
+      double p = pick(rng);
+      int op = 0;
+      while (op < NUM_OP_TYPES - 1 && p >= workload.mix_[op]) {
+        p -= workload.mix_[op];
+        op++;
+      }
+      auto start = std::chrono::steady_clock::now();
+      bool found = RunOp(&state, static_cast<OpType>(op), &rng, &local_checksum);
+      state.latency_[op].Record(bustub::ScopedMetricTimer::ElapsedNs(start));
+      if (!found) {
+        state.missed_[op].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    checksum += local_checksum;
+  });
+  if (tracing) {
+    auto trace = bustub::AccessTracer::Instance().Stop();
+    fprintf(stderr, "trace: %llu records written to %s, %llu dropped\n",
+            static_cast<unsigned long long>(trace.records_), config.trace_.c_str(),  // NOLINT
+            static_cast<unsigned long long>(trace.dropped_));                          // NOLINT
+  }
+
+  int status = 0;
+  if (state.failed_) {
+    fprintf(stderr, "benchmark failed: %s\n", state.error_.c_str());
+    status = 1;
+  } else {
+    bustub::ThrottledDiskManager::Stats disk{};
+    if (throttled != nullptr) {
+      disk = throttled->GetStats();
+      disk.pages_read_ -= disk_before.pages_read_;
+      disk.pages_written_ -= disk_before.pages_written_;
+      disk.queue_ns_ -= disk_before.queue_ns_;
+      disk.delay_ns_ -= disk_before.delay_ns_;
+    }
+    std::string result =
+        FormatResult(config, &state, load_seconds, run_seconds, throttled != nullptr ? &disk : nullptr);
+    fprintf(stderr, "run: workload %c, %s, %zu operations in %.3f s, %.1f ops/s\n", workload.name_,
+            DistributionName(config.distribution_), config.operations_, run_seconds,
+            static_cast<double>(config.operations_) / run_seconds);
+    if (config.output_.empty()) {
+      fputs(result.c_str(), stdout);
+    } else {
+      FILE *file = fopen(config.output_.c_str(), "w");
+      if (file == nullptr || fputs(result.c_str(), file) < 0) {
+        fprintf(stderr, "can't write %s\n", config.output_.c_str());
+        status = 1;
+      }
+      if (file != nullptr) {
+        fclose(file);
+      }
+    }
+  }
+
+  delete tree;
+  delete bpm;
+  delete throttled;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  std::remove(db_file.c_str());
+  std::remove("btree_bench.log");
+  return status;
+}
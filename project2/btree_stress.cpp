@@ -0,0 +1,580 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// btree_stress.cpp
+//
+// Identification: tools/btree_stress/btree_stress.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>  // NOLINT
+#include <random>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/exception.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h"  // NOLINT
+
+/**
+ * Concurrency stress test of BPlusTree with a linearizability checker.
+ *
+ * Every round builds a fresh tree over a fresh BufferPoolManagerInstance,
+ * prefills every other key of a small key range and lets --threads threads
+ * run --ops_per_thread random Insert, Remove, GetValue and scan operations on
+ * it. The defaults, a key range of 64, tiny nodes and a pool of 64 frames,
+ * make nearly every write split, merge or redistribute nodes and keep pages
+ * being evicted and read back. --pool_size must still cover the pages all
+ * threads pin at once, or operations fail for lack of a frame.
+ *
+ * Each operation is stamped from a global counter when it is called and when
+ * it returns. After the round the history of every key is checked against a
+ * model of one key (absent, or present with a value): there must be an order
+ * of the operations, each placed between its call and its return, in which
+ * every result matches the model (Wing & Gong's search with Lowe's cache of
+ * visited configurations). Linearizability is local, so checking keys one by
+ * one checks the whole history of these single-key operations. Inserted
+ * values are unique, so a read also tells which insert it saw.
+ *
+ * A scan is not atomic: every entry it returns is checked as a read of that
+ * key at some point during the scan, and the keys must be ascending and start
+ * at the scan key. Keys it skips are not checked. After the threads finish,
+ * every key is read once more and the tree is checked with Verify().
+ *
+ * Every thread draws its operations from a generator seeded from the round
+ * seed, --seed plus the round number, and yields at random points. The
+ * operation sequences are reproducible, the interleaving is not: rerun a
+ * failing round with --seed=<round seed> --rounds=1, repeatedly if need be.
+ * A violation prints the history of the key; the exit status is 1 then.
+ *
+ * Usage: btree_stress [--threads=N] [--ops_per_thread=N] [--keys=N] [--leaf_max_size=N] [--internal_max_size=N]
+ *                     [--pool_size=FRAMES] [--rounds=N] [--scan_percent=N] [--max_scan_length=N] [--seed=N]
+ *                     [--output=FILE]
+ */
+
+namespace {
+
+using KeyType = bustub::GenericKey<8>;
+using ValueType = bustub::RID;
+using ComparatorType = bustub::GenericComparator<8>;
+using TreeType = bustub::BPlusTree<KeyType, ValueType, ComparatorType>;
+
+/** Model state of a key not in the tree; RID::Get() of the values used is never negative. */
+constexpr int64_t ABSENT = -1;
+
+/** A SCAN event is one entry returned by a scan. */
+enum OpKind : uint8_t { INSERT, REMOVE, GET, SCAN, NUM_OP_KINDS };
+
+constexpr std::array<const char *, NUM_OP_KINDS> OP_NAMES = {"insert", "remove", "get", "scan"};
+
+struct Config {
+  size_t threads_{4};
+  size_t ops_per_thread_{2000};
+  size_t keys_{64};
+  int leaf_max_size_{3};
+  int internal_max_size_{4};
+  size_t pool_size_{64};
+  size_t rounds_{10};
+  size_t scan_percent_{10};
+  size_t max_scan_length_{8};
+  uint64_t seed_{1};
+  std::string output_;
+};
+
+/** One operation on one key, as its caller saw it. */
+struct Event {
+  uint64_t call_;
+  uint64_t return_;
+  OpKind kind_;
+  /** Index of the worker, Config::threads_ for the final reads. */
+  uint32_t thread_;
+  int64_t key_;
+  /** The value inserted or read, ABSENT if GetValue found nothing. */
+  int64_t value_;
+  /** What Insert returned. */
+  bool result_;
+};
+
+/** State shared by the workers of one round. */
+struct RoundState {
+  const Config *config_;
+  TreeType *tree_;
+  std::atomic<uint64_t> clock_{0};
+  std::atomic<bool> started_{false};
+  std::vector<std::vector<Event>> events_;
+  std::mutex error_latch_;
+  /** Set on an exception or a malformed scan; stops the workers. */
+  std::atomic<bool> failed_{false};
+  std::string error_;
+};
+
+struct Totals {
+  uint64_t ops_[NUM_OP_KINDS]{};
+  uint64_t explored_{0};
+};
+
+/** @return false on an unknown or malformed option */
+auto ParseArgs(int argc, char **argv, Config *config) -> bool {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      return false;
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    char *end = nullptr;
+    uint64_t number = std::strtoull(value.c_str(), &end, 10);
+    bool is_number = !value.empty() && *end == '\0';
+
+    if (name == "output") {
+      config->output_ = value;
+    } else if (!is_number) {
+      return false;
+    } else if (name == "threads") {
+      config->threads_ = number;
+    } else if (name == "ops_per_thread") {
+      config->ops_per_thread_ = number;
+    } else if (name == "keys") {
+      config->keys_ = number;
+    } else if (name == "leaf_max_size") {
+      config->leaf_max_size_ = static_cast<int>(number);
+    } else if (name == "internal_max_size") {
+      config->internal_max_size_ = static_cast<int>(number);
+    } else if (name == "pool_size") {
+      config->pool_size_ = number;
+    } else if (name == "rounds") {
+      config->rounds_ = number;
+    } else if (name == "scan_percent") {
+      config->scan_percent_ = number;
+    } else if (name == "max_scan_length") {
+      config->max_scan_length_ = number;
+    } else if (name == "seed") {
+      config->seed_ = number;
+    } else {
+      return false;
+    }
+  }
+  return config->threads_ > 0 && config->keys_ > 0 && config->scan_percent_ <= 100 && config->max_scan_length_ > 0;
+}
+
+/** @return the seed of a thread's generator, mixed so that neighbouring seeds and threads are unrelated */
+auto ThreadSeed(uint64_t round_seed, size_t thread) -> uint64_t {
+  uint64_t x = round_seed * 0x9E3779B97F4A7C15ULL + thread + 1;
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+auto KeyOf(int64_t id) -> KeyType {
+  KeyType key;
+  key.SetFromInteger(id);
+  return key;
+}
+
+/** The value the prefill inserts for a key. */
+auto InitialValue(int64_t id) -> ValueType { return ValueType(0, static_cast<uint32_t>(id)); }
+
+void Fail(RoundState *state, const std::string &error) {
+  std::scoped_lock<std::mutex> lock(state->error_latch_);
+  if (!state->failed_) {
+    state->error_ = error;
+    state->failed_ = true;
+  }
+}
+
+void Worker(RoundState *state, uint64_t round_seed, size_t t) {
+  const Config &config = *state->config_;
+  TreeType *tree = state->tree_;
+  std::vector<Event> &events = state->events_[t];
+  std::mt19937_64 rng(ThreadSeed(round_seed, t));
+  std::vector<ValueType> result;
+  std::vector<std::pair<int64_t, int64_t>> entries;
+
+  while (!state->started_.load()) {
+    std::this_thread::yield();
+  }
+  for (size_t i = 0; i < config.ops_per_thread_ && !state->failed_; i++) {
+    if (rng() % 8 == 0) {
+      std::this_thread::yield();
+    }
+    auto id = static_cast<int64_t>(rng() % config.keys_);
+    KeyType key = KeyOf(id);
+    Event event{0, 0, GET, static_cast<uint32_t>(t), id, ABSENT, false};
+
+    if (rng() % 100 < config.scan_percent_) {
+      size_t length = rng() % config.max_scan_length_ + 1;
+      entries.clear();
+      uint64_t call = state->clock_.fetch_add(1);
+      {
+        // The iterator latches its leaf, so it must be gone before the next operation
+        auto it = tree->Begin(key);
+        for (; entries.size() < length && !it.IsEnd(); ++it) {
+          entries.emplace_back((*it).first.ToString(), (*it).second.Get());
+        }
+      }
+      uint64_t ret = state->clock_.fetch_add(1);
+      int64_t previous = id - 1;
+      for (const auto &[entry_key, entry_value] : entries) {
+        if (entry_key <= previous) {
+          Fail(state, "scan from key " + std::to_string(id) + " by thread " + std::to_string(t) + " returned key " +
+                          std::to_string(entry_key) + " after " + std::to_string(previous));
+          return;
+        }
+        previous = entry_key;
+        events.push_back({call, ret, SCAN, static_cast<uint32_t>(t), entry_key, entry_value, true});
+      }
+      continue;
+    }
+
+    uint64_t choice = rng() % 10;
+    event.call_ = state->clock_.fetch_add(1);
+    if (choice < 4) {
+      ValueType value(static_cast<bustub::page_id_t>(t + 1), static_cast<uint32_t>(i));
+      event.kind_ = INSERT;
+      event.value_ = value.Get();
+      event.result_ = tree->Insert(key, value);
+    } else if (choice < 7) {
+      event.kind_ = REMOVE;
+      tree->Remove(key);
+    } else {
+      result.clear();
+      if (tree->GetValue(key, &result)) {
+        event.value_ = result[0].Get();
+      }
+    }
+    event.return_ = state->clock_.fetch_add(1);
+    events.push_back(event);
+  }
+}
+
+/** Apply op to the model; @return false if its result is impossible in state. */
+auto Apply(const Event &op, int64_t state, int64_t *next) -> bool {
+  *next = state;
+  switch (op.kind_) {
+    case INSERT:
+      if (state == ABSENT) {
+        *next = op.value_;
+      }
+      return op.result_ == (state == ABSENT);
+    case REMOVE:
+      *next = ABSENT;
+      return true;
+    case GET:
+    case SCAN:
+      return op.value_ == state;
+    default:
+      return false;
+  }
+}
+
+/**
+ * Search for a linearization of the operations on one key (Lowe, "Testing
+ * for linearizability", 2017). The calls and returns form a list in time
+ * order; linearizing an operation takes its call and return out of the list,
+ * and reaching a return whose operation is not linearized yet backtracks.
+ * @return true if a linearization exists
+ */
+auto CheckKey(const std::vector<Event> &ops, int64_t initial, uint64_t *explored) -> bool {
+  int n = static_cast<int>(ops.size());
+  // Entry 2i is the call of ops[i], 2i + 1 its return, 2n the head of the list
+  std::vector<std::pair<uint64_t, int>> order;
+  order.reserve(2 * n);
+  for (int i = 0; i < n; i++) {
+    order.emplace_back(ops[i].call_, 2 * i);
+    order.emplace_back(ops[i].return_, 2 * i + 1);
+  }
+  std::sort(order.begin(), order.end());
+  int head = 2 * n;
+  std::vector<int> next(2 * n + 1, -1);
+  std::vector<int> prev(2 * n + 1, -1);
+  int last = head;
+  for (const auto &[time, entry] : order) {
+    next[last] = entry;
+    prev[entry] = last;
+    last = entry;
+  }
+
+  auto unlink = [&](int entry) {
+    next[prev[entry]] = next[entry];
+    if (next[entry] != -1) {
+      prev[next[entry]] = prev[entry];
+    }
+  };
+  auto relink = [&](int entry) {
+    next[prev[entry]] = entry;
+    if (next[entry] != -1) {
+      prev[next[entry]] = entry;
+    }
+  };
+
+  std::vector<uint64_t> linearized((n + 63) / 64, 0);
+  std::set<std::pair<std::vector<uint64_t>, int64_t>> cache;
+  std::vector<std::pair<int, int64_t>> stack;
+  int64_t state = initial;
+  int entry = next[head];
+  while (next[head] != -1) {
+    int op = entry / 2;
+    if (entry % 2 == 0) {
+      int64_t next_state;
+      if (Apply(ops[op], state, &next_state)) {
+        linearized[op / 64] |= 1ULL << (op % 64);
+        if (cache.emplace(linearized, next_state).second) {
+          (*explored)++;
+          stack.emplace_back(op, state);
+          state = next_state;
+          unlink(2 * op);
+          unlink(2 * op + 1);
+          entry = next[head];
+          continue;
+        }
+        linearized[op / 64] &= ~(1ULL << (op % 64));
+      }
+      entry = next[entry];
+    } else {
+      // ops[op] returned before any order could take it
+      if (stack.empty()) {
+        return false;
+      }
+      auto [undo, undo_state] = stack.back();
+      stack.pop_back();
+      state = undo_state;
+      linearized[undo / 64] &= ~(1ULL << (undo % 64));
+      relink(2 * undo + 1);
+      relink(2 * undo);
+      entry = next[2 * undo];
+    }
+  }
+  return true;
+}
+
+auto FormatValue(int64_t value) -> std::string {
+  if (value == ABSENT) {
+    return "none";
+  }
+  return "(" + std::to_string(value >> 32) + "," + std::to_string(value & 0xFFFFFFFF) + ")";
+}
+
+auto FormatHistory(int64_t key, int64_t initial, std::vector<Event> ops) -> std::string {
+  std::sort(ops.begin(), ops.end(), [](const Event &a, const Event &b) { return a.call_ < b.call_; });
+  std::string out = "history of key " + std::to_string(key) + ", initially " + FormatValue(initial) + ":\n";
+  char line[256];
+  for (const auto &op : ops) {
+    std::string result;
+    if (op.kind_ == INSERT) {
+      result = FormatValue(op.value_) + " -> " + (op.result_ ? "true" : "false");
+    } else if (op.kind_ != REMOVE) {
+      result = "-> " + FormatValue(op.value_);
+    }
+    snprintf(line, sizeof(line), "  [%8llu, %8llu] thread %-2u %-6s %s\n",
+             static_cast<unsigned long long>(op.call_), static_cast<unsigned long long>(op.return_),  // NOLINT
+             op.thread_, OP_NAMES[op.kind_], result.c_str());
+    out += line;
+  }
+  return out;
+}
+
+/** Run one round; @return an empty string, or what went wrong */
+auto RunRound(const Config &config, bustub::DiskManager *disk_manager, uint64_t round_seed, Totals *totals)
+    -> std::string {
+  auto *bpm = new bustub::BufferPoolManagerInstance(config.pool_size_, disk_manager);
+  bustub::page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+  auto key_schema = bustub::ParseCreateStatement("a bigint");
+  ComparatorType comparator(key_schema.get());
+  auto *tree = new TreeType("btree_stress", bpm, comparator, config.leaf_max_size_, config.internal_max_size_);
+
+  RoundState state;
+  state.config_ = &config;
+  state.tree_ = tree;
+  state.events_.resize(config.threads_ + 1);
+  std::vector<int64_t> initial(config.keys_, ABSENT);
+  std::string error;
+
+  try {
+    for (size_t id = 0; id < config.keys_; id += 2) {
+      tree->Insert(KeyOf(id), InitialValue(id));
+      initial[id] = InitialValue(id).Get();
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < config.threads_; t++) {
+      workers.emplace_back([&state, round_seed, t] {
+        try {
+          Worker(&state, round_seed, t);
+        } catch (const bustub::Exception &e) {
+          Fail(&state, std::string("exception: ") + e.what());
+        }
+      });
+    }
+    state.started_ = true;
+    for (auto &worker : workers) {
+      worker.join();
+    }
+
+    // Read every key once more, after all other operations
+    std::vector<ValueType> result;
+    for (size_t id = 0; id < config.keys_ && !state.failed_; id++) {
+      Event event{0, 0, GET, static_cast<uint32_t>(config.threads_), static_cast<int64_t>(id), ABSENT, false};
+      result.clear();
+      event.call_ = state.clock_.fetch_add(1);
+      if (tree->GetValue(KeyOf(id), &result)) {
+        event.value_ = result[0].Get();
+      }
+      event.return_ = state.clock_.fetch_add(1);
+      state.events_[config.threads_].push_back(event);
+    }
+  } catch (const bustub::Exception &e) {
+    Fail(&state, std::string("exception: ") + e.what());
+  }
+  error = state.error_;
+
+  if (error.empty()) {
+    std::vector<std::vector<Event>> by_key(config.keys_);
+    for (const auto &events : state.events_) {
+      for (const auto &event : events) {
+        by_key[event.key_].push_back(event);
+        totals->ops_[event.kind_]++;
+      }
+    }
+    for (size_t id = 0; id < config.keys_ && error.empty(); id++) {
+      if (!CheckKey(by_key[id], initial[id], &totals->explored_)) {
+        error = "not linearizable, " + FormatHistory(id, initial[id], by_key[id]);
+      }
+    }
+  }
+  std::string verify_error;
+  if (error.empty() && !tree->Verify(&verify_error)) {
+    error = "tree is malformed: " + verify_error;
+  }
+
+  delete tree;
+  delete bpm;
+  return error;
+}
+
+auto EscapeJson(const std::string &text) -> std::string {
+  std::string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+auto FormatResult(const Config &config, const Totals &totals, size_t rounds, double seconds, uint64_t failed_seed,
+                  const std::string &error) -> std::string {
+  std::string out;
+  char item[512];
+  snprintf(item, sizeof(item),
+           "{\"config\":{\"threads\":%zu,\"ops_per_thread\":%zu,\"keys\":%zu,\"leaf_max_size\":%d,"
+           "\"internal_max_size\":%d,\"pool_size\":%zu,\"rounds\":%zu,\"scan_percent\":%zu,"
+           "\"max_scan_length\":%zu,\"seed\":%llu},",
+           config.threads_, config.ops_per_thread_, config.keys_, config.leaf_max_size_, config.internal_max_size_,
+           config.pool_size_, config.rounds_, config.scan_percent_, config.max_scan_length_,
+           static_cast<unsigned long long>(config.seed_));  // NOLINT
+  out += item;
+  snprintf(item, sizeof(item), "\"rounds\":%zu,\"seconds\":%.3f,\"states_explored\":%llu,\"ops\":{", rounds, seconds,
+           static_cast<unsigned long long>(totals.explored_));  // NOLINT
+  out += item;
+  for (int kind = 0; kind < NUM_OP_KINDS; kind++) {
+    snprintf(item, sizeof(item), "%s\"%s\":%llu", kind == 0 ? "" : ",", OP_NAMES[kind],
+             static_cast<unsigned long long>(totals.ops_[kind]));  // NOLINT
+    out += item;
+  }
+  out += "},\"failure\":";
+  if (error.empty()) {
+    out += "null";
+  } else {
+    snprintf(item, sizeof(item), "{\"seed\":%llu,\"error\":\"", static_cast<unsigned long long>(failed_seed));  // NOLINT
+    out += item;
+    out += EscapeJson(error) + "\"}";
+  }
+  out += "}\n";
+  return out;
+}
+
+}  // namespace
+
+auto main(int argc, char **argv) -> int {
+  Config config;
+  if (!ParseArgs(argc, argv, &config)) {
+    fprintf(stderr,
+            "usage: %s [--threads=N] [--ops_per_thread=N] [--keys=N] [--leaf_max_size=N] [--internal_max_size=N]\n"
+            "       [--pool_size=FRAMES] [--rounds=N] [--scan_percent=N] [--max_scan_length=N] [--seed=N]\n"
+            "       [--output=FILE]\n",
+            argv[0]);
+    return 1;
+  }
+
+  const std::string db_file = "btree_stress.db";
+  auto *disk_manager = new bustub::DiskManager(db_file);
+  Totals totals;
+  std::string error;
+  uint64_t failed_seed = 0;
+  size_t rounds = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (rounds < config.rounds_ && error.empty()) {
+    uint64_t round_seed = config.seed_ + rounds;
+    error = RunRound(config, disk_manager, round_seed, &totals);
+    rounds++;
+    if (!error.empty()) {
+      failed_seed = round_seed;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  int status = 0;
+  if (error.empty()) {
+    fprintf(stderr, "%zu rounds of %zu x %zu operations linearizable, %llu states explored, %.3f s\n", rounds,
+            config.threads_, config.ops_per_thread_, static_cast<unsigned long long>(totals.explored_),  // NOLINT
+            seconds);
+  } else {
+    fprintf(stderr, "round %zu failed, rerun with --seed=%llu --rounds=1\n%s\n", rounds - 1,
+            static_cast<unsigned long long>(failed_seed), error.c_str());  // NOLINT
+    status = 1;
+  }
+  std::string result = FormatResult(config, totals, rounds, seconds, failed_seed, error);
+  if (config.output_.empty()) {
+    fputs(result.c_str(), stdout);
+  } else {
+    FILE *file = fopen(config.output_.c_str(), "w");
+    if (file == nullptr || fputs(result.c_str(), file) < 0) {
+      fprintf(stderr, "can't write %s\n", config.output_.c_str());
+      status = 1;
+    }
+    if (file != nullptr) {
+      fclose(file);
+    }
+  }
+
+  disk_manager->ShutDown();
+  delete disk_manager;
+  std::remove(db_file.c_str());
+  std::remove("btree_stress.log");
+  return status;
+}
@@ -3,6 +3,9 @@
  */
 #include <cassert>
 
+#include "common/exception.h"
+#include "common/metrics.h"
+#include "storage/index/b_plus_tree.h"
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
@@ -13,22 +16,42 @@ namespace bustub {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator()
-    : page_id_(INVALID_PAGE_ID), leaf_(nullptr), index_(0), buffer_pool_manager_(nullptr) {}
+    : tree_(nullptr),
+      page_(nullptr),
+      page_id_(INVALID_PAGE_ID),
+      leaf_(nullptr),
+      index_(0),
+      buffer_pool_manager_(nullptr),
+      has_start_key_(false),
+      start_key_() {}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(LeafPage *leaf, int index, BufferPoolManager *buffer_pool_manager)
-    : page_id_(leaf != nullptr ? leaf->GetPageId() : INVALID_PAGE_ID),
-      leaf_(leaf),
-      index_(index),
-      buffer_pool_manager_(buffer_pool_manager) {}
+INDEXITERATOR_TYPE::IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, Page *page, int index,
+                                  BufferPoolManager *buffer_pool_manager, const KeyType *start_key)
+    : tree_(tree),
+      page_(page),
+      page_id_(page != nullptr ? page->GetPageId() : INVALID_PAGE_ID),
+      leaf_(page != nullptr ? reinterpret_cast<LeafPage *>(page->GetData()) : nullptr),
+      index_(page != nullptr ? index : 0),
+      buffer_pool_manager_(buffer_pool_manager),
+      has_start_key_(start_key != nullptr),
+      start_key_(start_key != nullptr ? *start_key : KeyType()) {
+  // The key may be past the last entry of its leaf
+  SkipExhaustedLeaves();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
-    : page_id_(other.page_id_),
+    : tree_(other.tree_),
+      page_(other.page_),
+      page_id_(other.page_id_),
       leaf_(other.leaf_),
       index_(other.index_),
-      buffer_pool_manager_(other.buffer_pool_manager_) {
+      buffer_pool_manager_(other.buffer_pool_manager_),
+      has_start_key_(other.has_start_key_),
+      start_key_(other.start_key_) {
   // Take ownership - nullify the source
+  other.page_ = nullptr;
   other.page_id_ = INVALID_PAGE_ID;
   other.leaf_ = nullptr;
   other.index_ = 0;
@@ -39,15 +62,18 @@ INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::operator=(IndexIterator &&other) noexcept -> IndexIterator & {
   if (this != &other) {
     // Release current resources
-    if (leaf_ != nullptr && buffer_pool_manager_ != nullptr) {
-      buffer_pool_manager_->UnpinPage(page_id_, false);
-    }
+    Release();
     // Take ownership from other
+    tree_ = other.tree_;
+    page_ = other.page_;
     page_id_ = other.page_id_;
     leaf_ = other.leaf_;
     index_ = other.index_;
     buffer_pool_manager_ = other.buffer_pool_manager_;
+    has_start_key_ = other.has_start_key_;
+    start_key_ = other.start_key_;
     // Nullify source
+    other.page_ = nullptr;
     other.page_id_ = INVALID_PAGE_ID;
     other.leaf_ = nullptr;
     other.index_ = 0;
@@ -57,10 +83,20 @@ auto INDEXITERATOR_TYPE::operator=(IndexIterator &&other) noexcept -> IndexItera
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() {
-  if (leaf_ != nullptr && buffer_pool_manager_ != nullptr) {
+INDEXITERATOR_TYPE::~IndexIterator() { Release(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Release() {
+  if (page_ != nullptr) {
+    page_->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id_, false);
+    // A writer may have failed to delete the page while this pin was held
+    tree_->RetryPendingDeletes();
   }
+  page_ = nullptr;
+  leaf_ = nullptr;
+  page_id_ = INVALID_PAGE_ID;
+  index_ = 0;  // Reset index to match End() iterator
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -75,27 +111,60 @@ auto INDEXITERATOR_TYPE::operator*() -> const MappingType & {
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & {
   index_++;
-  // If we've reached the end of the current leaf page
-  if (index_ >= leaf_->GetSize()) {
-    page_id_t next_page_id = leaf_->GetNextPageId();
-
-    // Unpin current page
-    buffer_pool_manager_->UnpinPage(page_id_, false);
+  SkipExhaustedLeaves();
+  return *this;
+}
 
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipExhaustedLeaves() {
+  while (leaf_ != nullptr && index_ >= leaf_->GetSize()) {
+    page_id_t next_page_id = leaf_->GetNextPageId();
     if (next_page_id == INVALID_PAGE_ID) {
       // Reached the end of the B+ tree
-      leaf_ = nullptr;
-      page_id_ = INVALID_PAGE_ID;
-      index_ = 0;  // Reset index to match End() iterator
-    } else {
-      // Move to the next leaf page
-      auto *next_page = buffer_pool_manager_->FetchPage(next_page_id);
-      leaf_ = reinterpret_cast<LeafPage *>(next_page->GetData());
+      Release();
+      return;
+    }
+
+    // Everything up to the last key of this leaf has been returned or was below the start key
+    KeyType last_key = leaf_->KeyAt(leaf_->GetSize() - 1);
+    bool before_start = has_start_key_ && tree_->comparator_(last_key, start_key_) < 0;
+    uint64_t version = tree_->structure_version_.load();
+
+    // The next leaf can only be merged away into this one, so pinning it while
+    // this one is latched keeps its page from being deleted and reused
+    BUSTUB_METRIC_COUNT("btree.scan_leaf", 1);
+    BUSTUB_METRIC_TIMER_START(start);
+    auto *next_page = buffer_pool_manager_->FetchPage(next_page_id, tree_->partition_);
+    BUSTUB_METRIC_TIMER_RECORD(start, "btree.scan_leaf_fetch_ns");
+    Release();
+    if (next_page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "Cannot fetch next leaf page for scan");
+    }
+    next_page->RLatch();
+
+    if (tree_->structure_version_.load() == version) {
+      page_ = next_page;
       page_id_ = next_page_id;
+      leaf_ = reinterpret_cast<LeafPage *>(next_page->GetData());
       index_ = 0;
+      continue;
+    }
+
+    // Entries moved between leaves while no latch was held; search again. Begin()
+    // takes the root latch, which a writer waiting for next_page may hold
+    BUSTUB_METRIC_COUNT("btree.scan_restart", 1);
+    next_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(next_page_id, false);
+    tree_->RetryPendingDeletes();
+    if (before_start) {
+      *this = tree_->Begin(start_key_);
+      continue;
+    }
+    *this = tree_->Begin(last_key);
+    if (leaf_ != nullptr && tree_->comparator_(leaf_->KeyAt(index_), last_key) == 0) {
+      index_++;
     }
   }
-  return *this;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -20,6 +20,23 @@ namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree;
+
+/**
+ * Iterator over the entries of a BPlusTree in key order. It holds a pin and a
+ * read latch on the leaf it is positioned on, so the leaf cannot change under
+ * it; writers that need the leaf wait until the iterator moves on or is
+ * destroyed. A thread must therefore not modify the tree while it holds an
+ * iterator that is not at the end.
+ *
+ * Moving to the next leaf never holds two latches at once. The next leaf is
+ * pinned while the current one is still latched, which keeps it from being
+ * deleted, and latched after the current one is released. If a split, merge
+ * or redistribution happened in that window, entries may have moved past the
+ * iterator, so it searches the tree again for the first key after the last
+ * key of the leaf it left.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
@@ -27,7 +44,12 @@ class IndexIterator {
  public:
   // you may define your own constructor based on your member variables
   IndexIterator();
-  IndexIterator(LeafPage *leaf, int index, BufferPoolManager *buffer_pool_manager);
+  /**
+   * Take over the pin and the read latch of page, a leaf of tree, or make an end iterator if page is nullptr.
+   * @param start_key the key the scan starts at, nullptr to start at the first key
+   */
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, Page *page, int index,
+                BufferPoolManager *buffer_pool_manager, const KeyType *start_key = nullptr);
   ~IndexIterator();  // NOLINT
 
   // Disable copy operations to prevent double unpin
@@ -49,11 +71,22 @@ class IndexIterator {
   auto operator!=(const IndexIterator &itr) const -> bool;
 
  private:
+  // move on to the next leaf while the current one has no entry at index_
+  void SkipExhaustedLeaves();
+
+  // drop the latch and the pin of the current leaf and become an end iterator
+  void Release();
+
   // add your own private member variables here
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_;
+  Page *page_;
   page_id_t page_id_;
   LeafPage *leaf_;
   int index_;
   BufferPoolManager *buffer_pool_manager_;
+  // a search after entries moved must not return keys before the start key
+  bool has_start_key_;
+  KeyType start_key_;
 };
 
 }  // namespace bustub
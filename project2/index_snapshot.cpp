@@ -0,0 +1,211 @@
+#include "storage/index/index_snapshot.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "common/exception.h"
+#include "storage/disk/page_codec.h"
+
+namespace bustub {
+
+namespace {
+
+void PutU32(char *dst, uint32_t value) { memcpy(dst, &value, sizeof(value)); }
+
+auto GetU32(const char *src) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, src, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+/*****************************************************************************
+ * WRITER
+ *****************************************************************************/
+
+IndexSnapshotWriter::IndexSnapshotWriter(const std::string &file_name, uint32_t key_size, uint32_t value_size)
+    : file_name_(file_name), key_size_(key_size), value_size_(value_size) {
+  fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    throw Exception("can't create snapshot file " + file_name);
+  }
+  block_.reserve(SNAPSHOT_BLOCK_SIZE);
+  out_.reserve(SNAPSHOT_WRITE_BUFFER_SIZE + SNAPSHOT_BLOCK_SIZE * 2);
+  // Placeholder, Finish() patches in the real entry count
+  char header[SNAPSHOT_HEADER_SIZE];
+  EncodeHeader(header);
+  out_.append(header, SNAPSHOT_HEADER_SIZE);
+}
+
+IndexSnapshotWriter::~IndexSnapshotWriter() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void IndexSnapshotWriter::EncodeHeader(char *header) const {
+  PutU32(header, SNAPSHOT_MAGIC);
+  PutU32(header + 4, SNAPSHOT_VERSION);
+  PutU32(header + 8, key_size_);
+  PutU32(header + 12, value_size_);
+  memcpy(header + 16, &entries_, sizeof(entries_));
+  PutU32(header + 24, PageCodec::Crc32(header, 24));
+}
+
+void IndexSnapshotWriter::Append(const char *key, const char *value) {
+  if (block_.size() + key_size_ + value_size_ > SNAPSHOT_BLOCK_SIZE) {
+    EncodeBlock();
+  }
+  block_.append(key, key_size_);
+  block_.append(value, value_size_);
+  entries_++;
+}
+
+void IndexSnapshotWriter::EncodeBlock() {
+  size_t header_pos = out_.size();
+  out_.resize(header_pos + SNAPSHOT_BLOCK_HEADER_SIZE);
+  PageCodec::Compress(block_.data(), block_.size(), &out_);
+  size_t encoded_size = out_.size() - header_pos - SNAPSHOT_BLOCK_HEADER_SIZE;
+  if (encoded_size >= block_.size()) {
+    // Incompressible, e.g. random keys filling the whole key width
+    out_.resize(header_pos + SNAPSHOT_BLOCK_HEADER_SIZE);
+    out_.append(block_);
+    encoded_size = block_.size();
+  }
+  PutU32(&out_[header_pos], static_cast<uint32_t>(block_.size()));
+  PutU32(&out_[header_pos + 4], static_cast<uint32_t>(encoded_size));
+  PutU32(&out_[header_pos + 8], PageCodec::Crc32(block_.data(), block_.size()));
+  block_.clear();
+
+  if (out_.size() >= SNAPSHOT_WRITE_BUFFER_SIZE) {
+    WriteOut();
+  }
+}
+
+void IndexSnapshotWriter::WriteOut() {
+  size_t written = 0;
+  while (!failed_ && written < out_.size()) {
+    ssize_t n = write(fd_, out_.data() + written, out_.size() - written);
+    if (n <= 0) {
+      failed_ = true;
+      break;
+    }
+    written += static_cast<size_t>(n);
+  }
+  out_.clear();
+}
+
+void IndexSnapshotWriter::Finish() {
+  if (!block_.empty()) {
+    EncodeBlock();
+  }
+  char end[SNAPSHOT_BLOCK_HEADER_SIZE] = {};
+  out_.append(end, sizeof(end));
+  WriteOut();
+  char header[SNAPSHOT_HEADER_SIZE];
+  EncodeHeader(header);
+  if (!failed_ && pwrite(fd_, header, SNAPSHOT_HEADER_SIZE, 0) != static_cast<ssize_t>(SNAPSHOT_HEADER_SIZE)) {
+    failed_ = true;
+  }
+  if (!failed_ && fsync(fd_) != 0) {
+    failed_ = true;
+  }
+  if (failed_) {
+    throw Exception("can't write snapshot file " + file_name_);
+  }
+}
+
+/*****************************************************************************
+ * READER
+ *****************************************************************************/
+
+IndexSnapshotReader::IndexSnapshotReader(const std::string &file_name, uint32_t key_size, uint32_t value_size)
+    : file_name_(file_name), key_size_(key_size), value_size_(value_size) {
+  fd_ = open(file_name.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw Exception("can't open snapshot file " + file_name);
+  }
+  char header[SNAPSHOT_HEADER_SIZE];
+  ReadFully(header, SNAPSHOT_HEADER_SIZE);
+  if (GetU32(header) != SNAPSHOT_MAGIC || GetU32(header + 24) != PageCodec::Crc32(header, 24)) {
+    throw Exception(file_name + " is not an index snapshot");
+  }
+  if (GetU32(header + 4) != SNAPSHOT_VERSION) {
+    throw Exception(file_name + " has an unsupported snapshot version");
+  }
+  if (GetU32(header + 8) != key_size || GetU32(header + 12) != value_size) {
+    throw Exception(ExceptionType::MISMATCH_TYPE, file_name + " holds keys or values of another size");
+  }
+  memcpy(&entries_, header + 16, sizeof(entries_));
+  block_.reserve(SNAPSHOT_BLOCK_SIZE);
+  encoded_.reserve(SNAPSHOT_BLOCK_SIZE);
+}
+
+IndexSnapshotReader::~IndexSnapshotReader() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void IndexSnapshotReader::ReadFully(char *buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = read(fd_, buf + done, len - done);
+    if (n <= 0) {
+      throw Exception("snapshot file " + file_name_ + " is truncated");
+    }
+    done += static_cast<size_t>(n);
+  }
+}
+
+auto IndexSnapshotReader::LoadBlock() -> bool {
+  char header[SNAPSHOT_BLOCK_HEADER_SIZE];
+  ReadFully(header, SNAPSHOT_BLOCK_HEADER_SIZE);
+  uint32_t raw_size = GetU32(header);
+  uint32_t encoded_size = GetU32(header + 4);
+  if (raw_size == 0) {
+    if (entries_read_ != entries_) {
+      throw Exception("snapshot file " + file_name_ + " is truncated");
+    }
+    end_ = true;
+    return false;
+  }
+  const size_t entry_size = key_size_ + value_size_;
+  if (raw_size > SNAPSHOT_BLOCK_SIZE || encoded_size > raw_size || raw_size % entry_size != 0) {
+    throw Exception("snapshot file " + file_name_ + " is corrupted");
+  }
+
+  block_.resize(raw_size);
+  if (encoded_size == raw_size) {
+    ReadFully(block_.data(), raw_size);
+  } else {
+    encoded_.resize(encoded_size);
+    ReadFully(encoded_.data(), encoded_size);
+    if (!PageCodec::Decompress(encoded_.data(), encoded_size, block_.data(), raw_size)) {
+      throw Exception("snapshot file " + file_name_ + " is corrupted");
+    }
+  }
+  if (PageCodec::Crc32(block_.data(), raw_size) != GetU32(header + 8)) {
+    throw Exception("snapshot file " + file_name_ + " is corrupted");
+  }
+  pos_ = 0;
+  return true;
+}
+
+auto IndexSnapshotReader::Next(char *key, char *value) -> bool {
+  if (pos_ == block_.size() && (end_ || !LoadBlock())) {
+    return false;
+  }
+  if (++entries_read_ > entries_) {
+    throw Exception("snapshot file " + file_name_ + " is corrupted");
+  }
+  memcpy(key, block_.data() + pos_, key_size_);
+  memcpy(value, block_.data() + pos_ + key_size_, value_size_);
+  pos_ += key_size_ + value_size_;
+  return true;
+}
+
+}  // namespace bustub
@@ -0,0 +1,141 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/include/storage/index/index_snapshot.h
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bustub {
+
+/**
+ * File format of an index snapshot, see BPlusTree::ExportSnapshot(). All
+ * integers are in host byte order.
+ *
+ *  -------------------------------------------------------------------------
+ * | magic (4) | version (4) | key_size (4) | value_size (4) | entries (8) |
+ * | header crc (4) | block | block | ... | end block                      |
+ *  -------------------------------------------------------------------------
+ *
+ * A block holds up to SNAPSHOT_BLOCK_SIZE bytes of entries, each the key bytes
+ * followed by the value bytes, in key order:
+ *
+ *  -----------------------------------------------------------
+ * | raw_size (4) | encoded_size (4) | raw crc (4) | encoded bytes |
+ *  -----------------------------------------------------------
+ *
+ * The entries are encoded with PageCodec, or stored as they are if that does
+ * not make them smaller (then encoded_size == raw_size). The end block has a
+ * raw_size of 0 and nothing else after its header. Checksums are CRC-32.
+ */
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x50534942;  // "BISP"
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+static constexpr size_t SNAPSHOT_HEADER_SIZE = 28;
+static constexpr size_t SNAPSHOT_BLOCK_HEADER_SIZE = 12;
+/** Bytes of entries per block. */
+static constexpr size_t SNAPSHOT_BLOCK_SIZE = 1 << 16;
+/** Bytes of encoded blocks the writer collects before it writes them out. */
+static constexpr size_t SNAPSHOT_WRITE_BUFFER_SIZE = 1 << 20;
+
+/**
+ * Writes a snapshot file sequentially. Entries are appended in key order; the
+ * entry count is patched into the header by Finish().
+ */
+class IndexSnapshotWriter {
+ public:
+  /**
+   * Create or truncate a snapshot file.
+   * @throws Exception if the file cannot be created
+   */
+  IndexSnapshotWriter(const std::string &file_name, uint32_t key_size, uint32_t value_size);
+  ~IndexSnapshotWriter();
+
+  IndexSnapshotWriter(const IndexSnapshotWriter &) = delete;
+  auto operator=(const IndexSnapshotWriter &) -> IndexSnapshotWriter & = delete;
+
+  /**
+   * Append one entry of key_size + value_size bytes. Never throws, so it can
+   * be called with pages pinned; a write error is reported by Finish().
+   */
+  void Append(const char *key, const char *value);
+
+  /**
+   * Write the last block and the end block, patch the entry count into the
+   * header and sync the file. Without it the file is not a valid snapshot.
+   * @throws Exception if any write failed
+   */
+  void Finish();
+
+  auto EntryCount() const -> uint64_t { return entries_; }
+
+ private:
+  void EncodeBlock();
+  void WriteOut();
+  void EncodeHeader(char *header) const;
+
+  int fd_{-1};
+  std::string file_name_;
+  uint32_t key_size_;
+  uint32_t value_size_;
+  uint64_t entries_{0};
+  /** Entries of the current block. */
+  std::string block_;
+  /** Encoded blocks not written yet. */
+  std::string out_;
+  bool failed_{false};
+};
+
+/**
+ * Reads a snapshot file written by IndexSnapshotWriter, checking the checksum
+ * of every block.
+ */
+class IndexSnapshotReader {
+ public:
+  /**
+   * Open a snapshot file and check its header.
+   * @throws Exception if the file cannot be opened, is no snapshot or holds
+   * keys or values of another size
+   */
+  IndexSnapshotReader(const std::string &file_name, uint32_t key_size, uint32_t value_size);
+  ~IndexSnapshotReader();
+
+  IndexSnapshotReader(const IndexSnapshotReader &) = delete;
+  auto operator=(const IndexSnapshotReader &) -> IndexSnapshotReader & = delete;
+
+  /** @return the number of entries recorded in the header */
+  auto EntryCount() const -> uint64_t { return entries_; }
+
+  /**
+   * Copy the next entry to key and value.
+   * @return false after the last entry
+   * @throws Exception if the file is truncated or corrupted
+   */
+  auto Next(char *key, char *value) -> bool;
+
+ private:
+  /** @return false at the end block */
+  auto LoadBlock() -> bool;
+  void ReadFully(char *buf, size_t len);
+
+  int fd_{-1};
+  std::string file_name_;
+  uint32_t key_size_;
+  uint32_t value_size_;
+  uint64_t entries_{0};
+  uint64_t entries_read_{0};
+  /** Decoded entries of the current block. */
+  std::string block_;
+  size_t pos_{0};
+  std::string encoded_;
+  bool end_{false};
+};
+
+}  // namespace bustub
@@ -0,0 +1,115 @@
+#include "storage/index/key_file_reader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+KeyFileReader::KeyFileReader(const std::string &file_name, KeyFileFormat format)
+    : file_name_(file_name), format_(format) {
+  fd_ = open(file_name.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw Exception("can't open key file " + file_name);
+  }
+  buffer_.resize(READ_BLOCK_SIZE);
+}
+
+KeyFileReader::~KeyFileReader() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+auto KeyFileReader::FillBuffer() -> bool {
+  if (eof_) {
+    return false;
+  }
+  // Move a token or key cut off at the end of the block to the front
+  size_t rest = size_ - pos_;
+  memmove(buffer_.data(), buffer_.data() + pos_, rest);
+  size_ = rest;
+  pos_ = 0;
+  if (size_ == buffer_.size()) {
+    // A single token longer than a block is garbage anyway; grow so we make progress
+    buffer_.resize(buffer_.size() * 2);
+  }
+
+  while (size_ < buffer_.size()) {
+    ssize_t n = read(fd_, buffer_.data() + size_, buffer_.size() - size_);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw Exception("can't read key file " + file_name_ + ": " + strerror(errno));
+    }
+    if (n == 0) {
+      // One more pass parses the last token, which no whitespace terminates
+      eof_ = true;
+      break;
+    }
+    size_ += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+auto KeyFileReader::ReadBatch(size_t max_keys, std::vector<int64_t> *keys) -> bool {
+  keys->clear();
+  while (keys->size() < max_keys) {
+    if (format_ == KeyFileFormat::BINARY) {
+      while (size_ - pos_ >= sizeof(int64_t) && keys->size() < max_keys) {
+        int64_t key;
+        memcpy(&key, buffer_.data() + pos_, sizeof(int64_t));
+        keys->push_back(key);
+        pos_ += sizeof(int64_t);
+      }
+    } else {
+      const char *end = buffer_.data() + size_;
+      while (keys->size() < max_keys) {
+        const char *begin = buffer_.data() + pos_;
+        while (begin < end && isspace(static_cast<unsigned char>(*begin)) != 0) {
+          begin++;
+        }
+        const char *token_end = begin;
+        while (token_end < end && isspace(static_cast<unsigned char>(*token_end)) == 0) {
+          token_end++;
+        }
+        // A token that runs into the end of the block may continue in the next one
+        if (token_end == end && !eof_) {
+          pos_ = begin - buffer_.data();
+          break;
+        }
+        pos_ = token_end - buffer_.data();
+        if (begin == token_end) {
+          break;
+        }
+        int64_t key;
+        auto [ptr, ec] = std::from_chars(begin, token_end, key);
+        if (ec != std::errc() || ptr != token_end) {
+          // A binary file read as text is one long token; quote only its start
+          std::string token(begin, std::min<size_t>(token_end - begin, 32));
+          throw Exception("malformed key \"" + token + "\" in key file " + file_name_);
+        }
+        keys->push_back(key);
+      }
+    }
+    if (keys->size() < max_keys && !FillBuffer()) {
+      // Only a binary file can end with bytes left over: fewer than those of a key
+      if (pos_ < size_) {
+        throw Exception("key file " + file_name_ + " ends in a partial key of " + std::to_string(size_ - pos_) +
+                        " bytes");
+      }
+      break;
+    }
+  }
+  return !keys->empty();
+}
+
+}  // namespace bustub
@@ -0,0 +1,76 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/include/storage/index/key_file_reader.h
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bustub {
+
+/** Layout of a file of int64_t keys, see KeyFileReader. */
+enum class KeyFileFormat {
+  /** Decimal integers separated by whitespace. */
+  TEXT,
+  /** Raw int64_t values in host byte order, 8 bytes each. */
+  BINARY
+};
+
+/**
+ * Reads the keys of a key file in batches, for BPlusTree::InsertFromFile()
+ * and friends. The file is read in blocks of READ_BLOCK_SIZE bytes and text is
+ * parsed with std::from_chars, so no per-key stream extraction is involved.
+ */
+class KeyFileReader {
+ public:
+  /** Bytes read from the file at a time. */
+  static constexpr size_t READ_BLOCK_SIZE = 1 << 20;
+
+  /**
+   * Open a key file.
+   * @throws Exception if the file cannot be opened
+   */
+  KeyFileReader(const std::string &file_name, KeyFileFormat format);
+  ~KeyFileReader();
+
+  KeyFileReader(const KeyFileReader &) = delete;
+  auto operator=(const KeyFileReader &) -> KeyFileReader & = delete;
+
+  /**
+   * Replace the contents of keys with the next keys of the file, at most
+   * max_keys of them.
+   * @return false once the file is exhausted and keys is empty
+   * @throws Exception on a read error, a text token that is not an int64_t,
+   * or a binary file whose size is not a multiple of 8
+   */
+  auto ReadBatch(size_t max_keys, std::vector<int64_t> *keys) -> bool;
+
+ private:
+  /**
+   * Refill buffer_ with the next block, keeping the unparsed bytes from pos_ on.
+   * @return false if the end of the file was already reached before
+   * @throws Exception on a read error
+   */
+  auto FillBuffer() -> bool;
+
+  std::string file_name_;
+  int fd_{-1};
+  KeyFileFormat format_;
+  std::vector<char> buffer_;
+  /** Bytes of buffer_ holding file data. */
+  size_t size_{0};
+  /** First byte of buffer_ not parsed yet. */
+  size_t pos_{0};
+  bool eof_{false};
+};
+
+}  // namespace bustub
@@ -0,0 +1,529 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_bench.cpp
+//
+// Identification: tools/page_bench/page_bench.cpp
+//
+// Copyright (c) 2015-2022, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+#include "test_util.h"  // NOLINT
+
+/**
+ * Microbenchmarks of the B+ tree page functions on in-memory pages, without a
+ * buffer pool, for every GenericKey size:
+ *
+ *   leaf.KeyIndex                 random probes into a full leaf, half of them present
+ *   leaf.Insert                   fill a half full leaf up to full, in random key order
+ *   leaf.RemoveAndDeleteRecord    empty a full leaf down to half full, in random key order
+ *   leaf.MoveHalfTo               split full leaves
+ *   internal.Lookup               random probes into a full internal page
+ *   internal.ValueIndex           search the child pointers of a full internal page
+ *   internal.InsertNodeAfter      fill a half full internal page up to full, in random order
+ *
+ * A kernel runs in blocks of operations; pages are reset between blocks
+ * outside the measured time, and blocks repeat for at least --min_time_ms.
+ * Besides the time per operation, cycles, instructions, L1D read misses and
+ * last-level cache misses per operation are counted with perf_event_open(2),
+ * in user space only. Without access to perf events (see
+ * /proc/sys/kernel/perf_event_paranoid) only the time is reported. Pin the
+ * benchmark to one core, e.g. with taskset, for stable numbers.
+ *
+ * A table goes to stderr, the results as one JSON object to stdout or --output.
+ *
+ * Usage: page_bench [--kernel=SUBSTRING] [--key_size=N] [--min_time_ms=N] [--seed=N] [--output=FILE]
+ */
+
+namespace {
+
+enum PerfEvent { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, NUM_PERF_EVENTS };
+
+constexpr std::array<const char *, NUM_PERF_EVENTS> PERF_EVENT_NAMES = {"cycles", "instructions", "l1d_misses",
+                                                                         "llc_misses"};
+
+/** Number of probes of the lookup kernels, and of leaves split per block by leaf.MoveHalfTo. */
+constexpr size_t PROBES = 1024;
+constexpr size_t SPLITS_PER_BLOCK = 32;
+
+struct Options {
+  std::string kernel_;
+  size_t key_size_{0};
+  uint64_t min_time_ms_{200};
+  uint64_t seed_{42};
+  std::string output_;
+};
+
+/** Keep the compiler from dropping a computation whose result is unused. */
+template <typename T>
+inline void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** A group of hardware counters of the calling thread, counting in user space while enabled. */
+class PerfCounters {
+ public:
+  PerfCounters() {
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      switch (event) {
+        case CYCLES:
+          attr.config = PERF_COUNT_HW_CPU_CYCLES;
+          break;
+        case INSTRUCTIONS:
+          attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+          break;
+        case L1D_MISSES:
+          attr.type = PERF_TYPE_HW_CACHE;
+          attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+          break;
+        default:
+          attr.config = PERF_COUNT_HW_CACHE_MISSES;
+          break;
+      }
+      attr.disabled = event == CYCLES ? 1 : 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      int group = event == CYCLES ? -1 : fds_[CYCLES];
+      fds_[event] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+      if (event == CYCLES && fds_[event] < 0) {
+        return;
+      }
+      // A missing member event is left out, the others still count
+      if (fds_[event] >= 0) {
+        ioctl(fds_[event], PERF_EVENT_IOC_ID, &ids_[event]);
+      }
+    }
+  }
+
+  ~PerfCounters() {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  auto operator=(const PerfCounters &) -> PerfCounters & = delete;
+
+  auto Available() const -> bool { return fds_[CYCLES] >= 0; }
+  auto Has(int event) const -> bool { return fds_[event] >= 0; }
+
+  void Reset() {
+    if (Available()) {
+      ioctl(fds_[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+  }
+  void Start() {
+    if (Available()) {
+      ioctl(fds_[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+  void Stop() {
+    if (Available()) {
+      ioctl(fds_[CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+
+  /** @return the counts since Reset(), scaled up if the group was multiplexed with other users of the counters */
+  auto Read() const -> std::array<double, NUM_PERF_EVENTS> {
+    std::array<double, NUM_PERF_EVENTS> counts{};
+    if (!Available()) {
+      return counts;
+    }
+    // nr, time_enabled, time_running, then a value and id per event
+    std::array<uint64_t, 3 + 2 * NUM_PERF_EVENTS> buf{};
+    if (read(fds_[CYCLES], buf.data(), sizeof(buf)) <= 0) {
+      return counts;
+    }
+    double scale = buf[2] == 0 ? 0.0 : static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+    for (uint64_t i = 0; i < buf[0] && i < NUM_PERF_EVENTS; i++) {
+      for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+        if (Has(event) && ids_[event] == buf[4 + 2 * i]) {
+          counts[event] = static_cast<double>(buf[3 + 2 * i]) * scale;
+        }
+      }
+    }
+    return counts;
+  }
+
+ private:
+  std::array<int, NUM_PERF_EVENTS> fds_{-1, -1, -1, -1};
+  std::array<uint64_t, NUM_PERF_EVENTS> ids_{};
+};
+
+struct KernelResult {
+  std::string kernel_;
+  size_t key_size_;
+  uint64_t ops_{0};
+  double ns_per_op_{0};
+  std::array<double, NUM_PERF_EVENTS> per_op_{};
+};
+
+/**
+ * Run reset() then the measured body(), which returns the number of
+ * operations it did, until min_time_ms of measured time have passed.
+ */
+template <typename Reset, typename Body>
+auto Measure(const char *kernel, size_t key_size, const Options &options, PerfCounters *perf, Reset reset, Body body)
+    -> KernelResult {
+  KernelResult result{kernel, key_size};
+  // Warm up caches and the branch predictor
+  reset();
+  body();
+
+  perf->Reset();
+  uint64_t elapsed_ns = 0;
+  while (elapsed_ns < options.min_time_ms_ * 1000000) {
+    reset();
+    perf->Start();
+    auto start = std::chrono::steady_clock::now();
+    result.ops_ += body();
+    auto end = std::chrono::steady_clock::now();
+    perf->Stop();
+    elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  }
+  result.ns_per_op_ = static_cast<double>(elapsed_ns) / static_cast<double>(result.ops_);
+  std::array<double, NUM_PERF_EVENTS> counts = perf->Read();
+  for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+    result.per_op_[event] = counts[event] / static_cast<double>(result.ops_);
+  }
+  return result;
+}
+
+/** A page-sized, cache line aligned buffer. */
+struct alignas(64) PageBuffer {
+  char data_[bustub::BUSTUB_PAGE_SIZE];
+};
+
+/** The key schema GenericComparator<KeySize> compares by: 4 bytes are an integer, wider keys bigints. */
+auto KeySchema(size_t key_size) -> std::string {
+  if (key_size == 4) {
+    return "a integer";
+  }
+  std::string schema;
+  for (size_t i = 0; i < key_size / 8; i++) {
+    schema += std::string(i == 0 ? "" : ", ") + static_cast<char>('a' + i) + " bigint";
+  }
+  return schema;
+}
+
+template <size_t KeySize>
+auto MakeKey(int64_t value) -> bustub::GenericKey<KeySize> {
+  bustub::GenericKey<KeySize> key;
+  memset(key.data_, 0, KeySize);
+  if constexpr (KeySize == 4) {
+    auto narrow = static_cast<int32_t>(value);
+    memcpy(key.data_, &narrow, sizeof(narrow));
+  } else {
+    memcpy(key.data_, &value, sizeof(value));
+  }
+  return key;
+}
+
+template <size_t KeySize>
+void RunKeySize(const Options &options, PerfCounters *perf, std::vector<KernelResult> *results) {
+  using KeyType = bustub::GenericKey<KeySize>;
+  using ComparatorType = bustub::GenericComparator<KeySize>;
+  using LeafPage = bustub::BPlusTreeLeafPage<KeyType, bustub::RID, ComparatorType>;
+  using InternalPage = bustub::BPlusTreeInternalPage<KeyType, bustub::page_id_t, ComparatorType>;
+
+  auto key_schema = bustub::ParseCreateStatement(KeySchema(KeySize));
+  ComparatorType comparator(key_schema.get());
+  std::mt19937_64 rng(options.seed_ + KeySize);
+  auto selected = [&](const char *kernel) {
+    return options.kernel_.empty() || std::string(kernel).find(options.kernel_) != std::string::npos;
+  };
+
+  // Leaves: the full template holds keys 0, 2, 4, ...; the half full one every other of them, the
+  // others are inserted into it or removed from the full one
+  const int leaf_full = (LeafPage::Capacity() - 1) & ~1;
+  auto leaf_pages = std::make_unique<PageBuffer[]>(2 * SPLITS_PER_BLOCK + 2);  // NOLINT
+  auto *full_leaf = reinterpret_cast<LeafPage *>(leaf_pages[0].data_);
+  auto *half_leaf = reinterpret_cast<LeafPage *>(leaf_pages[1].data_);
+  full_leaf->Init(1, bustub::INVALID_PAGE_ID, LeafPage::Capacity());
+  half_leaf->Init(1, bustub::INVALID_PAGE_ID, LeafPage::Capacity());
+  std::vector<KeyType> leaf_moved;
+  for (int i = 0; i < leaf_full; i++) {
+    KeyType key = MakeKey<KeySize>(2 * i);
+    full_leaf->Insert(key, bustub::RID(i), comparator);
+    if (i % 2 == 0) {
+      half_leaf->Insert(key, bustub::RID(i), comparator);
+    } else {
+      leaf_moved.push_back(key);
+    }
+  }
+  std::shuffle(leaf_moved.begin(), leaf_moved.end(), rng);
+  std::vector<KeyType> probes;
+  for (size_t i = 0; i < PROBES; i++) {
+    probes.push_back(MakeKey<KeySize>(std::uniform_int_distribution<int64_t>(0, 2 * leaf_full - 1)(rng)));
+  }
+  PageBuffer work;
+  auto *leaf = reinterpret_cast<LeafPage *>(work.data_);
+
+  if (selected("leaf.KeyIndex")) {
+    memcpy(work.data_, full_leaf, bustub::BUSTUB_PAGE_SIZE);
+    results->push_back(Measure(
+        "leaf.KeyIndex", KeySize, options, perf, [] {},
+        [&] {
+          for (const auto &probe : probes) {
+            DoNotOptimize(leaf->KeyIndex(probe, comparator));
+          }
+          return probes.size();
+        }));
+  }
+  if (selected("leaf.Insert")) {
+    results->push_back(Measure(
+        "leaf.Insert", KeySize, options, perf, [&] { memcpy(work.data_, half_leaf, bustub::BUSTUB_PAGE_SIZE); },
+        [&] {
+          for (const auto &key : leaf_moved) {
+            DoNotOptimize(leaf->Insert(key, bustub::RID(0), comparator));
+          }
+          return leaf_moved.size();
+        }));
+  }
+  if (selected("leaf.RemoveAndDeleteRecord")) {
+    results->push_back(Measure(
+        "leaf.RemoveAndDeleteRecord", KeySize, options, perf,
+        [&] { memcpy(work.data_, full_leaf, bustub::BUSTUB_PAGE_SIZE); },
+        [&] {
+          for (const auto &key : leaf_moved) {
+            DoNotOptimize(leaf->RemoveAndDeleteRecord(key, comparator));
+          }
+          return leaf_moved.size();
+        }));
+  }
+  if (selected("leaf.MoveHalfTo")) {
+    auto split = [&](size_t i) { return reinterpret_cast<LeafPage *>(leaf_pages[2 + i].data_); };
+    results->push_back(Measure(
+        "leaf.MoveHalfTo", KeySize, options, perf,
+        [&] {
+          for (size_t i = 0; i < SPLITS_PER_BLOCK; i++) {
+            memcpy(leaf_pages[2 + 2 * i].data_, full_leaf, bustub::BUSTUB_PAGE_SIZE);
+            split(2 * i + 1)->Init(2, bustub::INVALID_PAGE_ID, LeafPage::Capacity());
+          }
+        },
+        [&] {
+          for (size_t i = 0; i < SPLITS_PER_BLOCK; i++) {
+            split(2 * i)->MoveHalfTo(split(2 * i + 1));
+          }
+          DoNotOptimize(split(1)->GetSize());
+          return SPLITS_PER_BLOCK;
+        }));
+  }
+
+  // Internal pages: entry i has key 2i (entry 0 has none) and child 1000 + i, the half full template
+  // the even entries; the odd ones are inserted after their left neighbour
+  const int internal_full = (InternalPage::Capacity() - 1) & ~1;
+  PageBuffer full_internal_buffer;
+  PageBuffer half_internal_buffer;
+  auto *full_internal = reinterpret_cast<InternalPage *>(full_internal_buffer.data_);
+  auto *half_internal = reinterpret_cast<InternalPage *>(half_internal_buffer.data_);
+  full_internal->Init(1, bustub::INVALID_PAGE_ID, InternalPage::Capacity());
+  half_internal->Init(1, bustub::INVALID_PAGE_ID, InternalPage::Capacity());
+  std::vector<int> internal_moved;
+  for (int i = 0; i < internal_full; i++) {
+    full_internal->SetKeyAt(i, MakeKey<KeySize>(2 * i));
+    full_internal->SetValueAt(i, 1000 + i);
+    if (i % 2 == 0) {
+      half_internal->SetKeyAt(i / 2, MakeKey<KeySize>(2 * i));
+      half_internal->SetValueAt(i / 2, 1000 + i);
+    } else {
+      internal_moved.push_back(i);
+    }
+  }
+  full_internal->SetSize(internal_full);
+  half_internal->SetSize(internal_full / 2);
+  std::shuffle(internal_moved.begin(), internal_moved.end(), rng);
+  std::vector<KeyType> internal_moved_keys;
+  for (int i : internal_moved) {
+    internal_moved_keys.push_back(MakeKey<KeySize>(2 * i));
+  }
+  std::vector<KeyType> internal_keys;
+  std::vector<bustub::page_id_t> children;
+  for (size_t i = 0; i < PROBES; i++) {
+    internal_keys.push_back(MakeKey<KeySize>(std::uniform_int_distribution<int64_t>(0, 2 * internal_full - 1)(rng)));
+    children.push_back(1000 + std::uniform_int_distribution<int>(0, internal_full - 1)(rng));
+  }
+  auto *internal = reinterpret_cast<InternalPage *>(work.data_);
+
+  if (selected("internal.Lookup")) {
+    memcpy(work.data_, full_internal, bustub::BUSTUB_PAGE_SIZE);
+    results->push_back(Measure(
+        "internal.Lookup", KeySize, options, perf, [] {},
+        [&] {
+          for (const auto &key : internal_keys) {
+            DoNotOptimize(internal->Lookup(key, comparator));
+          }
+          return internal_keys.size();
+        }));
+  }
+  if (selected("internal.ValueIndex")) {
+    memcpy(work.data_, full_internal, bustub::BUSTUB_PAGE_SIZE);
+    results->push_back(Measure(
+        "internal.ValueIndex", KeySize, options, perf, [] {},
+        [&] {
+          for (bustub::page_id_t child : children) {
+            DoNotOptimize(internal->ValueIndex(child));
+          }
+          return children.size();
+        }));
+  }
+  if (selected("internal.InsertNodeAfter")) {
+    results->push_back(Measure(
+        "internal.InsertNodeAfter", KeySize, options, perf,
+        [&] { memcpy(work.data_, half_internal, bustub::BUSTUB_PAGE_SIZE); },
+        [&] {
+          for (size_t j = 0; j < internal_moved.size(); j++) {
+            int i = internal_moved[j];
+            DoNotOptimize(internal->InsertNodeAfter(1000 + i - 1, internal_moved_keys[j], 1000 + i));
+          }
+          return internal_moved.size();
+        }));
+  }
+}
+
+auto ParseArgs(int argc, char **argv, Options *options) -> bool {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      return false;
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    char *end = nullptr;
+    uint64_t number = std::strtoull(value.c_str(), &end, 10);
+    bool is_number = !value.empty() && *end == '\0';
+
+    if (name == "kernel") {
+      options->kernel_ = value;
+    } else if (name == "output") {
+      options->output_ = value;
+    } else if (!is_number) {
+      return false;
+    } else if (name == "key_size") {
+      options->key_size_ = number;
+    } else if (name == "min_time_ms") {
+      options->min_time_ms_ = number;
+    } else if (name == "seed") {
+      options->seed_ = number;
+    } else {
+      return false;
+    }
+  }
+  return options->min_time_ms_ > 0;
+}
+
+auto FormatResults(const std::vector<KernelResult> &results, const PerfCounters &perf) -> std::string {
+  std::string out = "{\"results\":[";
+  char item[512];
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto &result = results[i];
+    snprintf(item, sizeof(item), "%s{\"kernel\":\"%s\",\"key_size\":%zu,\"ops\":%llu,\"ns_per_op\":%.3f",
+             i == 0 ? "" : ",", result.kernel_.c_str(), result.key_size_,
+             static_cast<unsigned long long>(result.ops_), result.ns_per_op_);  // NOLINT
+    out += item;
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+      if (perf.Has(event)) {
+        snprintf(item, sizeof(item), ",\"%s_per_op\":%.3f", PERF_EVENT_NAMES[event], result.per_op_[event]);
+        out += item;
+      }
+    }
+    out += "}";
+  }
+  out += "]}\n";
+  return out;
+}
+
+}  // namespace
+
+auto main(int argc, char **argv) -> int {
+  Options options;
+  if (!ParseArgs(argc, argv, &options)) {
+    fprintf(stderr, "usage: %s [--kernel=SUBSTRING] [--key_size=N] [--min_time_ms=N] [--seed=N] [--output=FILE]\n",
+            argv[0]);
+    return 1;
+  }
+
+  PerfCounters perf;
+  if (!perf.Available()) {
+    fprintf(stderr, "perf events unavailable (see /proc/sys/kernel/perf_event_paranoid), timing only\n");
+  }
+  std::vector<KernelResult> results;
+  if (options.key_size_ == 0 || options.key_size_ == 4) {
+    RunKeySize<4>(options, &perf, &results);
+  }
+  if (options.key_size_ == 0 || options.key_size_ == 8) {
+    RunKeySize<8>(options, &perf, &results);
+  }
+  if (options.key_size_ == 0 || options.key_size_ == 16) {
+    RunKeySize<16>(options, &perf, &results);
+  }
+  if (options.key_size_ == 0 || options.key_size_ == 32) {
+    RunKeySize<32>(options, &perf, &results);
+  }
+  if (options.key_size_ == 0 || options.key_size_ == 64) {
+    RunKeySize<64>(options, &perf, &results);
+  }
+  if (results.empty()) {
+    fprintf(stderr, "no kernel selected\n");
+    return 1;
+  }
+
+  fprintf(stderr, "%-28s %4s %11s %11s %11s %11s %11s\n", "kernel", "key", "ns/op", "cycles/op", "instr/op",
+          "l1d_miss/op", "llc_miss/op");
+  for (const auto &result : results) {
+    fprintf(stderr, "%-28s %4zu %11.2f", result.kernel_.c_str(), result.key_size_, result.ns_per_op_);
+    for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+      if (perf.Has(event)) {
+        fprintf(stderr, " %11.2f", result.per_op_[event]);
+      } else {
+        fprintf(stderr, " %11s", "-");
+      }
+    }
+    fprintf(stderr, "\n");
+  }
+
+  std::string json = FormatResults(results, perf);
+  if (options.output_.empty()) {
+    fputs(json.c_str(), stdout);
+    return 0;
+  }
+  FILE *file = fopen(options.output_.c_str(), "w");
+  if (file == nullptr || fputs(json.c_str(), file) < 0) {
+    fprintf(stderr, "can't write %s\n", options.output_.c_str());
+    if (file != nullptr) {
+      fclose(file);
+    }
+    return 1;
+  }
+  fclose(file);
+  return 0;
+}